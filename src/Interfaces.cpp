@@ -2,6 +2,7 @@
 
 #include "Interfaces.h"
 #include "GD.h"
+#include "PhysicalInterfaces/ReplayInterface.h"
 
 namespace MyFamily
 {
@@ -22,9 +23,12 @@ void Interfaces::create()
 		for(std::map<std::string, Systems::PPhysicalInterfaceSettings>::iterator i = _physicalInterfaceSettings.begin(); i != _physicalInterfaceSettings.end(); ++i)
 		{
 			std::shared_ptr<MainInterface> device;
-			if(!i->second || i->second->host.empty()) continue;
+			if(!i->second) continue;
+			//Replay interfaces read the file set in "device" instead of connecting to "host".
+			if(i->second->type == "replay" ? i->second->device.empty() : i->second->host.empty()) continue;
 			GD::out.printDebug("Debug: Creating physical device. Type defined in beckhoff.conf is: " + i->second->type);
 			if(i->second->type == "bk90x0") device.reset(new MainInterface(i->second));
+			else if(i->second->type == "replay") device.reset(new ReplayInterface(i->second));
 			else GD::out.printError("Error: Unsupported physical device type: " + i->second->type);
 			if(device)
 			{
@@ -0,0 +1,398 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#include "InterlockEngine.h"
+
+#include <set>
+#include <sstream>
+
+namespace MyFamily
+{
+
+bool InterlockEngine::load(const std::string& content, const std::string& interfaceId, std::string& error)
+{
+	_instructions.clear();
+	_rules.clear();
+
+	std::istringstream stream(content);
+	std::string line;
+	std::string section;
+	uint32_t lineNumber = 0;
+	while(std::getline(stream, line))
+	{
+		lineNumber++;
+		auto commentPosition = line.find('#');
+		if(commentPosition != std::string::npos) line.resize(commentPosition);
+		BaseLib::HelperFunctions::trim(line);
+		if(line.empty()) continue;
+
+		if(line.front() == '[')
+		{
+			if(line.back() != ']')
+			{
+				error = "Invalid section header in line " + std::to_string(lineNumber) + ".";
+				_instructions.clear();
+				_rules.clear();
+				return false;
+			}
+			section = line.substr(1, line.size() - 2);
+			BaseLib::HelperFunctions::trim(section);
+			continue;
+		}
+		if(section != interfaceId) continue;
+
+		if(!parseRule(line, error))
+		{
+			error = "Line " + std::to_string(lineNumber) + ": " + error;
+			_instructions.clear();
+			_rules.clear();
+			return false;
+		}
+	}
+	_expression.clear();
+	return true;
+}
+
+std::vector<uint32_t> InterlockEngine::getInputRegisters()
+{
+	std::set<uint32_t> registers;
+	for(auto& instruction : _instructions)
+	{
+		if(instruction.opCode == OpCode::inputBit) registers.insert(instruction.operand / 16);
+		else if(instruction.opCode == OpCode::unsignedRegister || instruction.opCode == OpCode::signedRegister) registers.insert(instruction.operand);
+	}
+	return std::vector<uint32_t>(registers.begin(), registers.end());
+}
+
+bool InterlockEngine::execute(const std::vector<uint16_t>& inputs, std::vector<uint16_t>& outputs)
+{
+	bool changed = false;
+	bool stack[_maxStackSize];
+	for(auto& rule : _rules)
+	{
+		uint32_t stackSize = 0;
+		const Instruction* instruction = _instructions.data() + rule.firstInstruction;
+		const Instruction* end = instruction + rule.instructionCount;
+		for(; instruction != end; ++instruction)
+		{
+			switch(instruction->opCode)
+			{
+			case OpCode::constant:
+				stack[stackSize++] = instruction->operand != 0;
+				break;
+			case OpCode::inputBit:
+				stack[stackSize++] = instruction->operand / 16 < inputs.size() && (inputs[instruction->operand / 16] & (1 << (instruction->operand % 16)));
+				break;
+			case OpCode::outputBit:
+				stack[stackSize++] = instruction->operand / 16 < outputs.size() && (outputs[instruction->operand / 16] & (1 << (instruction->operand % 16)));
+				break;
+			case OpCode::unsignedRegister:
+			case OpCode::signedRegister:
+			{
+				int32_t value = 0;
+				if(instruction->operand < inputs.size()) value = instruction->opCode == OpCode::signedRegister ? (int32_t)(int16_t)inputs[instruction->operand] : (int32_t)inputs[instruction->operand];
+				bool result = false;
+				switch(instruction->comparison)
+				{
+				case Comparison::less: result = value < instruction->value; break;
+				case Comparison::lessOrEqual: result = value <= instruction->value; break;
+				case Comparison::greater: result = value > instruction->value; break;
+				case Comparison::greaterOrEqual: result = value >= instruction->value; break;
+				case Comparison::equal: result = value == instruction->value; break;
+				case Comparison::notEqual: result = value != instruction->value; break;
+				}
+				stack[stackSize++] = result;
+				break;
+			}
+			case OpCode::notOp:
+				stack[stackSize - 1] = !stack[stackSize - 1];
+				break;
+			case OpCode::andOp:
+				stackSize--;
+				stack[stackSize - 1] = stack[stackSize - 1] && stack[stackSize];
+				break;
+			case OpCode::xorOp:
+				stackSize--;
+				stack[stackSize - 1] = stack[stackSize - 1] != stack[stackSize];
+				break;
+			case OpCode::orOp:
+				stackSize--;
+				stack[stackSize - 1] = stack[stackSize - 1] || stack[stackSize];
+				break;
+			}
+		}
+
+		uint32_t index = rule.outputBit / 16;
+		if(index >= outputs.size()) continue;
+		uint16_t mask = 1 << (rule.outputBit % 16);
+		bool value = outputs[index] & mask;
+		bool result = stack[0];
+		if(rule.assignment == Assignment::andSet) result = value && result;
+		else if(rule.assignment == Assignment::orSet) result = value || result;
+		if(result == value) continue;
+
+		if(result) outputs[index] |= mask;
+		else outputs[index] &= ~mask;
+		changed = true;
+	}
+	return changed;
+}
+
+//{{{ Parser
+void InterlockEngine::skipWhitespace()
+{
+	while(_position < _expression.size() && std::isspace((unsigned char)_expression[_position])) _position++;
+}
+
+bool InterlockEngine::parseNumber(int64_t& number)
+{
+	skipWhitespace();
+	size_t start = _position;
+	if(_position < _expression.size() && _expression[_position] == '-') _position++;
+	while(_position < _expression.size() && std::isdigit((unsigned char)_expression[_position])) _position++;
+	if(_position == start || (_position == start + 1 && _expression[start] == '-') || _position - start > 10)
+	{
+		_position = start;
+		return false;
+	}
+	number = std::stoll(_expression.substr(start, _position - start));
+	return true;
+}
+
+void InterlockEngine::emit(const Instruction& instruction)
+{
+	switch(instruction.opCode)
+	{
+	case OpCode::notOp:
+		break;
+	case OpCode::andOp:
+	case OpCode::xorOp:
+	case OpCode::orOp:
+		_stackSize--;
+		break;
+	default:
+		_stackSize++;
+		if(_stackSize > _maxUsedStackSize) _maxUsedStackSize = _stackSize;
+		break;
+	}
+	_instructions.push_back(instruction);
+}
+
+bool InterlockEngine::parseOr(std::string& error)
+{
+	if(!parseXor(error)) return false;
+	skipWhitespace();
+	while(_position < _expression.size() && _expression[_position] == '|')
+	{
+		_position++;
+		if(!parseXor(error)) return false;
+		Instruction instruction;
+		instruction.opCode = OpCode::orOp;
+		emit(instruction);
+		skipWhitespace();
+	}
+	return true;
+}
+
+bool InterlockEngine::parseXor(std::string& error)
+{
+	if(!parseAnd(error)) return false;
+	skipWhitespace();
+	while(_position < _expression.size() && _expression[_position] == '^')
+	{
+		_position++;
+		if(!parseAnd(error)) return false;
+		Instruction instruction;
+		instruction.opCode = OpCode::xorOp;
+		emit(instruction);
+		skipWhitespace();
+	}
+	return true;
+}
+
+bool InterlockEngine::parseAnd(std::string& error)
+{
+	if(!parseUnary(error)) return false;
+	skipWhitespace();
+	while(_position < _expression.size() && _expression[_position] == '&')
+	{
+		_position++;
+		if(!parseUnary(error)) return false;
+		Instruction instruction;
+		instruction.opCode = OpCode::andOp;
+		emit(instruction);
+		skipWhitespace();
+	}
+	return true;
+}
+
+bool InterlockEngine::parseUnary(std::string& error)
+{
+	skipWhitespace();
+	if(_position < _expression.size() && _expression[_position] == '!')
+	{
+		_position++;
+		if(!parseUnary(error)) return false;
+		Instruction instruction;
+		instruction.opCode = OpCode::notOp;
+		emit(instruction);
+		return true;
+	}
+	return parsePrimary(error);
+}
+
+bool InterlockEngine::parsePrimary(std::string& error)
+{
+	skipWhitespace();
+	if(_position >= _expression.size())
+	{
+		error = "Unexpected end of expression.";
+		return false;
+	}
+
+	char character = _expression[_position];
+	if(character == '(')
+	{
+		_position++;
+		if(!parseOr(error)) return false;
+		skipWhitespace();
+		if(_position >= _expression.size() || _expression[_position] != ')')
+		{
+			error = "Missing \")\".";
+			return false;
+		}
+		_position++;
+		return true;
+	}
+
+	Instruction instruction;
+	int64_t number = 0;
+	if(character == '0' || character == '1')
+	{
+		_position++;
+		instruction.opCode = OpCode::constant;
+		instruction.operand = character == '1' ? 1 : 0;
+		emit(instruction);
+		return true;
+	}
+
+	if(character != 'I' && character != 'O' && character != 'R' && character != 'S')
+	{
+		error = "Unexpected character \"" + std::string(1, character) + "\" at position " + std::to_string(_position + 1) + ".";
+		return false;
+	}
+	_position++;
+	if(_position >= _expression.size() || !std::isdigit((unsigned char)_expression[_position]) || !parseNumber(number) || number > 65535)
+	{
+		error = "Invalid bit or register number at position " + std::to_string(_position + 1) + ".";
+		return false;
+	}
+	instruction.operand = (uint32_t)number;
+
+	if(character == 'I' || character == 'O')
+	{
+		instruction.opCode = character == 'I' ? OpCode::inputBit : OpCode::outputBit;
+		emit(instruction);
+		return true;
+	}
+
+	instruction.opCode = character == 'R' ? OpCode::unsignedRegister : OpCode::signedRegister;
+	skipWhitespace();
+	std::string comparison;
+	while(_position < _expression.size() && comparison.size() < 2 && (_expression[_position] == '<' || _expression[_position] == '>' || _expression[_position] == '=' || _expression[_position] == '!'))
+	{
+		comparison.push_back(_expression[_position]);
+		_position++;
+	}
+	if(comparison == "<") instruction.comparison = Comparison::less;
+	else if(comparison == "<=") instruction.comparison = Comparison::lessOrEqual;
+	else if(comparison == ">") instruction.comparison = Comparison::greater;
+	else if(comparison == ">=") instruction.comparison = Comparison::greaterOrEqual;
+	else if(comparison == "==") instruction.comparison = Comparison::equal;
+	else if(comparison == "!=") instruction.comparison = Comparison::notEqual;
+	else
+	{
+		error = "Registers must be compared with <, <=, >, >=, == or != at position " + std::to_string(_position + 1) + ".";
+		return false;
+	}
+	if(!parseNumber(number) || number < -32768 || number > 65535)
+	{
+		error = "Invalid value at position " + std::to_string(_position + 1) + ".";
+		return false;
+	}
+	instruction.value = (int32_t)number;
+	emit(instruction);
+	return true;
+}
+
+bool InterlockEngine::parseRule(const std::string& line, std::string& error)
+{
+	_expression = line;
+	_position = 0;
+	_stackSize = 0;
+	_maxUsedStackSize = 0;
+
+	Rule rule;
+	int64_t number = 0;
+	skipWhitespace();
+	if(_position >= _expression.size() || _expression[_position] != 'O')
+	{
+		error = "Rules must start with an output bit (e.g. \"O3 = I1\").";
+		return false;
+	}
+	_position++;
+	if(_position >= _expression.size() || !std::isdigit((unsigned char)_expression[_position]) || !parseNumber(number) || number > 65535)
+	{
+		error = "Invalid output bit.";
+		return false;
+	}
+	rule.outputBit = (uint32_t)number;
+
+	skipWhitespace();
+	if(_expression.compare(_position, 2, "&=") == 0)
+	{
+		rule.assignment = Assignment::andSet;
+		_position += 2;
+	}
+	else if(_expression.compare(_position, 2, "|=") == 0)
+	{
+		rule.assignment = Assignment::orSet;
+		_position += 2;
+	}
+	else if(_expression.compare(_position, 1, "=") == 0)
+	{
+		rule.assignment = Assignment::set;
+		_position += 1;
+	}
+	else
+	{
+		error = "Expected \"=\", \"&=\" or \"|=\" after the output bit.";
+		return false;
+	}
+
+	size_t instructionCount = _instructions.size();
+	rule.firstInstruction = instructionCount;
+	if(!parseOr(error))
+	{
+		_instructions.resize(instructionCount);
+		return false;
+	}
+	skipWhitespace();
+	if(_position != _expression.size())
+	{
+		error = "Unexpected character \"" + std::string(1, _expression[_position]) + "\" at position " + std::to_string(_position + 1) + ".";
+		_instructions.resize(instructionCount);
+		return false;
+	}
+	if(_maxUsedStackSize > _maxStackSize)
+	{
+		error = "Expression is too complex.";
+		_instructions.resize(instructionCount);
+		return false;
+	}
+	rule.instructionCount = _instructions.size() - instructionCount;
+	_rules.push_back(rule);
+	return true;
+}
+//}}}
+
+}
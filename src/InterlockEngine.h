@@ -0,0 +1,128 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#ifndef INTERLOCKENGINE_H_
+#define INTERLOCKENGINE_H_
+
+#include <homegear-base/BaseLib.h>
+
+namespace MyFamily
+{
+
+/**
+ * Evaluates interlock rules of one interface after every cycle and writes the results directly into the output image.
+ *
+ * Rules are read from the section "[<interface ID>]" of the rules file. One rule per line:
+ *
+ *     O<bit> = <expression>   Sets the output bit to the result.
+ *     O<bit> &= <expression>  Clears the output bit when the result is false (e.g. a limit switch).
+ *     O<bit> |= <expression>  Sets the output bit when the result is true.
+ *
+ * "&=" and "|=" change the output image itself, so the bit keeps its value after the condition is gone until it is
+ * changed again.
+ *
+ * The rules bypass the peers. Output peers are neither updated nor raise events when a rule changes one of their bits,
+ * so their STATE shows the value last set through Homegear, not the value written to the coupler.
+ *
+ * Expressions consist of input bits (I<bit>), output bits (O<bit>), comparisons of unsigned or signed input registers
+ * with constants (R<register> > 1000, S<register> <= -20), the constants 0 and 1, !, &, ^, | (in decreasing precedence)
+ * and parentheses. Bits and registers are numbered from 0 within the process image. "#" starts a comment.
+ *
+ * The rules are compiled to a flat list of instructions in reverse polish notation when they are loaded, so evaluating
+ * them needs neither allocations nor lookups.
+ */
+class InterlockEngine
+{
+public:
+	InterlockEngine() = default;
+	virtual ~InterlockEngine() = default;
+
+	/**
+	 * Compiles the rules of the section interfaceId. Returns false and sets error when a rule is invalid. No rule is
+	 * loaded in that case.
+	 */
+	bool load(const std::string& content, const std::string& interfaceId, std::string& error);
+
+	size_t ruleCount() { return _rules.size(); }
+
+	/**
+	 * Returns the input registers used by the rules, so they can be read every cycle.
+	 */
+	std::vector<uint32_t> getInputRegisters();
+
+	/**
+	 * Evaluates all rules. Returns true when an output bit changed.
+	 */
+	bool execute(const std::vector<uint16_t>& inputs, std::vector<uint16_t>& outputs);
+private:
+	enum class OpCode : uint8_t
+	{
+		constant,
+		inputBit,
+		outputBit,
+		unsignedRegister,
+		signedRegister,
+		notOp,
+		andOp,
+		xorOp,
+		orOp
+	};
+
+	enum class Comparison : uint8_t
+	{
+		less,
+		lessOrEqual,
+		greater,
+		greaterOrEqual,
+		equal,
+		notEqual
+	};
+
+	enum class Assignment : uint8_t
+	{
+		set,
+		andSet,
+		orSet
+	};
+
+	struct Instruction
+	{
+		OpCode opCode = OpCode::constant;
+		Comparison comparison = Comparison::equal;
+		uint32_t operand = 0; //Bit, register or constant
+		int32_t value = 0; //Compared value of register instructions
+	};
+
+	struct Rule
+	{
+		uint32_t outputBit = 0;
+		Assignment assignment = Assignment::set;
+		uint32_t firstInstruction = 0;
+		uint32_t instructionCount = 0;
+	};
+
+	static constexpr uint32_t _maxStackSize = 32;
+
+	std::vector<Instruction> _instructions;
+	std::vector<Rule> _rules;
+
+	//{{{ Parser state
+	std::string _expression;
+	size_t _position = 0;
+	uint32_t _stackSize = 0;
+	uint32_t _maxUsedStackSize = 0;
+
+	void skipWhitespace();
+	bool parseNumber(int64_t& number);
+	void emit(const Instruction& instruction);
+	bool parseOr(std::string& error);
+	bool parseXor(std::string& error);
+	bool parseAnd(std::string& error);
+	bool parseUnary(std::string& error);
+	bool parsePrimary(std::string& error);
+	bool parseRule(const std::string& line, std::string& error);
+	//}}}
+};
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include "GD.h"
 
 #include <iomanip>
+#include <unordered_set>
 
 namespace MyFamily {
 
@@ -34,6 +35,14 @@ void MyCentral::dispose(bool wait)
 			//Just to make sure cycle through all physical devices. If event handler is not removed => segfault
 			i->second->removeEventHandler(_physicalInterfaceEventhandlers[i->first]);
 		}
+
+		{
+			std::lock_guard<std::mutex> workerGuard(_workerMutex);
+			_stopWorkerThread = true;
+		}
+		_workerConditionVariable.notify_all();
+		_bl->threadManager.join(_workerThread);
+		stopDecoderThreads();
 	}
     catch(const std::exception& ex)
     {
@@ -48,10 +57,95 @@ void MyCentral::init()
 		if(_initialized) return; //Prevent running init two times
 		_initialized = true;
 
+		_localRpcMethods.emplace("createDevices", std::bind(&MyCentral::createDevices, this, std::placeholders::_1, std::placeholders::_2));
+		_localRpcMethods.emplace("deleteDevices", std::bind(&MyCentral::deleteDevices, this, std::placeholders::_1, std::placeholders::_2));
+		_localRpcMethods.emplace("getProcessImageHistory", std::bind(&MyCentral::getProcessImageHistory, this, std::placeholders::_1, std::placeholders::_2));
+
 		for(std::map<std::string, std::shared_ptr<MainInterface>>::iterator i = GD::physicalInterfaces.begin(); i != GD::physicalInterfaces.end(); ++i)
 		{
+			auto interfacePeers = std::unique_ptr<InterfacePeers>(new InterfacePeers());
+			interfacePeers->inputPeers = std::make_shared<std::vector<PMyPeer>>();
+			_interfacePeers.emplace(i->first, std::move(interfacePeers));
+
 			_physicalInterfaceEventhandlers[i->first] = i->second->addEventHandler((BaseLib::Systems::IPhysicalInterface::IPhysicalInterfaceEventSink*)this);
 		}
+
+		auto readGapThresholdSetting = GD::family->getFamilySetting("readgapthreshold");
+		if(readGapThresholdSetting && readGapThresholdSetting->integerValue >= 0) _readGapThreshold = readGapThresholdSetting->integerValue;
+
+		startDecoderThreads();
+		_bl->threadManager.start(_workerThread, true, &MyCentral::worker, this);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MyCentral::wakeUpWorker()
+{
+	{
+		std::lock_guard<std::mutex> workerGuard(_workerMutex);
+		_workerWakeUp = true;
+	}
+	_workerConditionVariable.notify_one();
+}
+
+void MyCentral::worker()
+{
+	int32_t timeToSleep = 100;
+	while(!_stopWorkerThread)
+	{
+		try
+		{
+			{
+				std::unique_lock<std::mutex> workerGuard(_workerMutex);
+				_workerConditionVariable.wait_for(workerGuard, std::chrono::milliseconds(timeToSleep), [&] { return _stopWorkerThread || _workerWakeUp; });
+				if(_stopWorkerThread) return;
+				_workerWakeUp = false;
+			}
+
+			//Peers with pending deadlines like debounced inputs shorten the interval.
+			timeToSleep = 100;
+			for(auto& interfacePeers : _interfacePeers)
+			{
+				std::shared_ptr<std::vector<PMyPeer>> inputPeers;
+				{
+					std::lock_guard<std::mutex> inputPeersGuard(interfacePeers.second->inputPeersMutex);
+					inputPeers = interfacePeers.second->inputPeers;
+				}
+				for(auto& peer : *inputPeers)
+				{
+					int32_t timeToNextCall = peer->worker();
+					if(timeToNextCall >= 0 && timeToNextCall < timeToSleep) timeToSleep = timeToNextCall;
+				}
+			}
+			if(timeToSleep < 1) timeToSleep = 1;
+		}
+		catch(const std::exception& ex)
+		{
+			GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+		}
+	}
+}
+
+//{{{ Decoder pool
+void MyCentral::startDecoderThreads()
+{
+	try
+	{
+		auto setting = GD::family->getFamilySetting("decoderthreads");
+		if(!setting || setting->integerValue <= 0) return;
+		int32_t threadCount = setting->integerValue;
+		if(threadCount > 64) threadCount = 64;
+
+		_stopDecoderThreads = false;
+		_decoderThreads.resize(threadCount);
+		for(auto& thread : _decoderThreads)
+		{
+			_bl->threadManager.start(thread, true, &MyCentral::decoderThread, this);
+		}
+		GD::out.printInfo("Info: Started " + std::to_string(threadCount) + " decoder threads.");
 	}
 	catch(const std::exception& ex)
 	{
@@ -59,6 +153,119 @@ void MyCentral::init()
 	}
 }
 
+void MyCentral::stopDecoderThreads()
+{
+	try
+	{
+		{
+			std::lock_guard<std::mutex> decoderGuard(_decoderMutex);
+			_stopDecoderThreads = true;
+		}
+		_decoderConditionVariable.notify_all();
+		for(auto& thread : _decoderThreads)
+		{
+			_bl->threadManager.join(thread);
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MyCentral::decoderThread()
+{
+	std::vector<uint16_t> destinationData;
+	destinationData.reserve(16);
+	uint64_t generation = 0;
+	while(!_stopDecoderThreads)
+	{
+		try
+		{
+			{
+				std::unique_lock<std::mutex> decoderGuard(_decoderMutex);
+				_decoderConditionVariable.wait(decoderGuard, [&] { return _stopDecoderThreads || _decoderGeneration != generation; });
+				if(_stopDecoderThreads) return;
+				generation = _decoderGeneration;
+				_decoderActiveWorkers++;
+			}
+
+			decodeQueuedPeers(destinationData);
+
+			{
+				std::lock_guard<std::mutex> decoderGuard(_decoderMutex);
+				_decoderActiveWorkers--;
+			}
+			_decoderDoneConditionVariable.notify_all();
+		}
+		catch(const std::exception& ex)
+		{
+			GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+		}
+	}
+}
+
+void MyCentral::decodeQueuedPeers(std::vector<uint16_t>& destinationData)
+{
+	if(!_decoderPeers) return;
+	const std::vector<PMyPeer>& peers = *_decoderPeers;
+
+	//Every thread takes the next undecoded peer, so threads finishing early pick up the remaining work.
+	for(uint32_t index = _decoderNextPeer++; index < peers.size(); index = _decoderNextPeer++)
+	{
+		decodePeer(*_decoderSourceData, peers[index], destinationData);
+		_decoderFinishedPeers++;
+	}
+}
+
+void MyCentral::decodePeer(const std::vector<uint16_t>& sourceData, const PMyPeer& peer, std::vector<uint16_t>& destinationData)
+{
+	try
+	{
+		uint32_t startBit = peer->getInputAddress();
+		uint32_t endBit = startBit + peer->getInputMemorySize() - 1;
+		int32_t offset = startBit % 16;
+		uint32_t currentSourceByte = startBit / 16;
+		uint32_t currentSourceBit = startBit % 16;
+		uint32_t currentDestinationByte = 0;
+		uint32_t currentDestinationBit = 0;
+
+		if(currentSourceByte >= sourceData.size()) return;
+
+		uint32_t registerSize = peer->getInputMemorySize() / 16;
+		if(peer->getInputMemorySize() % 16 != 0) registerSize++;
+		destinationData.assign(registerSize, 0); //Reuses the capacity of the previous peer's buffer
+
+		for(uint32_t j = startBit; j <= endBit; j++)
+		{
+			if(offset >= 0) destinationData[currentDestinationByte] |= (sourceData[currentSourceByte] & _bitMask[currentSourceBit]) >> offset;
+			else destinationData[currentDestinationByte] |= (sourceData[currentSourceByte] & _bitMask[currentSourceBit]) << (offset * -1);
+			currentSourceBit++;
+			currentDestinationBit++;
+			if(currentDestinationBit == 16)
+			{
+				currentDestinationBit = 0;
+				currentDestinationByte++;
+				offset = currentSourceBit;
+			}
+			if(currentSourceBit == 16)
+			{
+				currentSourceBit = 0;
+				offset = -currentDestinationBit;
+				currentSourceByte++;
+				if(currentSourceByte >= sourceData.size()) break;
+			}
+		}
+
+		peer->packetReceived(destinationData);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+//}}}
+
 void MyCentral::loadPeers()
 {
 	try
@@ -131,65 +338,50 @@ bool MyCentral::onPacketReceived(std::string& senderID, std::shared_ptr<BaseLib:
 		std::shared_ptr<MyPacket> myPacket(std::dynamic_pointer_cast<MyPacket>(packet));
 		if(!myPacket) return false;
 
-		std::vector<std::shared_ptr<MyPeer>> peers;
+		auto interfacePeersIterator = _interfacePeers.find(senderID);
+		if(interfacePeersIterator == _interfacePeers.end()) return false;
+		std::shared_ptr<std::vector<PMyPeer>> inputPeers;
 		{
-			std::lock_guard<std::mutex> peersGuard(_peersMutex);
-			peers.reserve(_peersById.size());
-			for(auto& peerIterator : _peersById)
-			{
-				std::shared_ptr<MyPeer> peer(std::dynamic_pointer_cast<MyPeer>(peerIterator.second));
-				if(peer->isOutputDevice() || senderID != peer->getPhysicalInterface()->getID()) continue;
-				peers.push_back(peer);
-			}
+			std::lock_guard<std::mutex> inputPeersGuard(interfacePeersIterator->second->inputPeersMutex);
+			inputPeers = interfacePeersIterator->second->inputPeers;
 		}
+		if(!inputPeers || inputPeers->empty()) return false;
+		const std::vector<PMyPeer>& peers = *inputPeers;
 
-		uint32_t startBit = 0;
-		uint32_t endBit = 0;
-		int32_t offset = 0;
-		uint32_t currentSourceByte = 0;
-		uint32_t currentSourceBit = 0;
-		uint32_t currentDestinationByte = 0;
-		uint32_t currentDestinationBit = 0;
 		std::vector<uint16_t>& sourceData = myPacket->getData();
 		std::vector<uint16_t> destinationData;
-		for(auto& peer : peers)
-		{
-			startBit = peer->getInputAddress();
-			endBit = startBit + peer->getInputMemorySize() - 1;
-			offset = startBit % 16;
-			currentSourceByte = startBit / 16;
-			currentSourceBit = startBit % 16;
-			currentDestinationByte = 0;
-			currentDestinationBit = 0;
+		destinationData.reserve(16);
 
-			if(currentSourceByte >= sourceData.size()) continue;
-
-			uint32_t registerSize = peer->getInputMemorySize() / 16;
-			if(peer->getInputMemorySize() % 16 != 0) registerSize++;
-			destinationData = std::vector<uint16_t>(registerSize, 0);
-
-			for(uint32_t j = startBit; j <= endBit; j++)
+		//Only one packet is distributed to the decoder threads at a time. Packets of other interfaces arriving meanwhile are decoded sequentially.
+		std::unique_lock<std::mutex> batchGuard(_decoderBatchMutex, std::defer_lock);
+		if(_decoderThreads.empty() || peers.size() < 2 || !batchGuard.try_lock())
+		{
+			for(auto& peer : peers)
 			{
-				if(offset >= 0) destinationData[currentDestinationByte] |= (sourceData[currentSourceByte] & _bitMask[currentSourceBit]) >> offset;
-				else destinationData[currentDestinationByte] |= (sourceData[currentSourceByte] & _bitMask[currentSourceBit]) << (offset * -1);
-				currentSourceBit++;
-				currentDestinationBit++;
-				if(currentDestinationBit == 16)
-				{
-					currentDestinationBit = 0;
-					currentDestinationByte++;
-					offset = currentSourceBit;
-				}
-				if(currentSourceBit == 16)
-				{
-					currentSourceBit = 0;
-					offset = -currentDestinationBit;
-					currentSourceByte++;
-					if(currentSourceByte >= sourceData.size()) break;
-				}
+				decodePeer(sourceData, peer, destinationData);
 			}
+			return false;
+		}
 
-            peer->packetReceived(destinationData);
+		{
+			std::unique_lock<std::mutex> decoderGuard(_decoderMutex);
+			_decoderDoneConditionVariable.wait(decoderGuard, [&] { return _decoderActiveWorkers == 0; });
+			_decoderSourceData = &sourceData;
+			_decoderPeers = inputPeers;
+			_decoderNextPeer = 0;
+			_decoderFinishedPeers = 0;
+			_decoderGeneration++;
+		}
+		_decoderConditionVariable.notify_all();
+
+		decodeQueuedPeers(destinationData);
+
+		{
+			//Join before the next cycle
+			std::unique_lock<std::mutex> decoderGuard(_decoderMutex);
+			_decoderDoneConditionVariable.wait(decoderGuard, [&] { return _decoderActiveWorkers == 0 && _decoderFinishedPeers >= peers.size(); });
+			_decoderPeers.reset();
+			_decoderSourceData = nullptr;
 		}
 	}
 	catch(const std::exception& ex)
@@ -217,51 +409,80 @@ void MyCentral::savePeers(bool full)
 }
 
 void MyCentral::deletePeer(uint64_t id)
+{
+	std::vector<uint64_t> ids{ id };
+	deletePeers(ids);
+}
+
+void MyCentral::deletePeers(const std::vector<uint64_t>& ids)
 {
 	try
 	{
-		std::shared_ptr<MyPeer> peer(getPeer(id));
-		if(!peer) return;
-		peer->deleting = true;
-		PVariable deviceAddresses(new Variable(VariableType::tArray));
-		deviceAddresses->arrayValue->push_back(PVariable(new Variable(peer->getSerialNumber())));
-
-		PVariable deviceInfo(new Variable(VariableType::tStruct));
-		deviceInfo->structValue->insert(StructElement("ID", PVariable(new Variable((int32_t)peer->getID()))));
-		PVariable channels(new Variable(VariableType::tArray));
-		deviceInfo->structValue->insert(StructElement("CHANNELS", channels));
-
-		for(Functions::iterator i = peer->getRpcDevice()->functions.begin(); i != peer->getRpcDevice()->functions.end(); ++i)
+		std::vector<std::shared_ptr<MyPeer>> peers;
+		peers.reserve(ids.size());
+		for(auto id : ids)
 		{
-			deviceAddresses->arrayValue->push_back(PVariable(new Variable(peer->getSerialNumber() + ":" + std::to_string(i->first))));
-			channels->arrayValue->push_back(PVariable(new Variable(i->first)));
-		}
+			std::shared_ptr<MyPeer> peer(getPeer(id));
+			if(!peer) continue;
+			peer->deleting = true;
+			PVariable deviceAddresses(new Variable(VariableType::tArray));
+			deviceAddresses->arrayValue->push_back(PVariable(new Variable(peer->getSerialNumber())));
+
+			PVariable deviceInfo(new Variable(VariableType::tStruct));
+			deviceInfo->structValue->insert(StructElement("ID", PVariable(new Variable((int32_t)peer->getID()))));
+			PVariable channels(new Variable(VariableType::tArray));
+			deviceInfo->structValue->insert(StructElement("CHANNELS", channels));
+
+			for(Functions::iterator i = peer->getRpcDevice()->functions.begin(); i != peer->getRpcDevice()->functions.end(); ++i)
+			{
+				deviceAddresses->arrayValue->push_back(PVariable(new Variable(peer->getSerialNumber() + ":" + std::to_string(i->first))));
+				channels->arrayValue->push_back(PVariable(new Variable(i->first)));
+			}
 
-        std::vector<uint64_t> deletedIds{ id };
-		raiseRPCDeleteDevices(deletedIds, deviceAddresses, deviceInfo);
+			std::vector<uint64_t> deletedIds{ id };
+			raiseRPCDeleteDevices(deletedIds, deviceAddresses, deviceInfo);
 
-        {
-            std::lock_guard<std::mutex> peersGuard(_peersMutex);
-            if(_peersBySerial.find(peer->getSerialNumber()) != _peersBySerial.end()) _peersBySerial.erase(peer->getSerialNumber());
-            if(_peersById.find(id) != _peersById.end()) _peersById.erase(id);
-        }
+			{
+				std::lock_guard<std::mutex> peersGuard(_peersMutex);
+				if(_peersBySerial.find(peer->getSerialNumber()) != _peersBySerial.end()) _peersBySerial.erase(peer->getSerialNumber());
+				if(_peersById.find(id) != _peersById.end()) _peersById.erase(id);
+			}
 
-        int32_t i = 0;
-        while(peer.use_count() > 1 && i < 600)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            i++;
-        }
-        if(i == 600) GD::out.printError("Error: Peer deletion took too long.");
+			peers.push_back(peer);
+		}
+
+		//Release the references held by the snapshots before waiting
+		updateInputPeers();
 
-		peer->deleteFromDatabase();
-		GD::out.printMessage("Removed Beckhoff BK90x0 peer " + std::to_string(peer->getID()));
+		//Wait for all peers at once, so deleting many peers doesn't add up the waiting times.
+		int32_t i = 0;
+		while(i < 6000)
+		{
+			bool inUse = false;
+			for(auto& peer : peers)
+			{
+				if(peer.use_count() > 1)
+				{
+					inUse = true;
+					break;
+				}
+			}
+			if(!inUse) break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			i++;
+		}
+		if(i == 6000) GD::out.printError("Error: Peer deletion took too long.");
+
+		for(auto& peer : peers)
+		{
+			peer->deleteFromDatabase();
+			GD::out.printMessage("Removed Beckhoff BK90x0 peer " + std::to_string(peer->getID()));
+		}
 	}
 	catch(const std::exception& ex)
-    {
-		_peersMutex.unlock();
-        GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
-    }
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
 }
 
 std::string MyCentral::handleCliCommand(std::string command)
@@ -284,6 +505,8 @@ std::string MyCentral::handleCliCommand(std::string command)
 			stringStream << "send                Sends a raw packet" << std::endl;
 			stringStream << "readbuffer          Prints the read buffer of an interface" << std::endl;
             stringStream << "writebuffer         Prints the write buffer of an interface" << std::endl;
+            stringStream << "interfacestatus     Prints status information and counters of an interface" << std::endl;
+            stringStream << "history             Prints the recent process images of an interface" << std::endl;
 			stringStream << "unselect (u)        Unselect this device" << std::endl;
 			return stringStream.str();
 		}
@@ -355,11 +578,12 @@ std::string MyCentral::handleCliCommand(std::string command)
 					peer->save(true, true, false);
 					peer->initializeCentralConfig();
 					peer->setPhysicalInterfaceId(interfaceId);
+					peer->updateCaches();
                     peersGuard.lock();
 					_peersById[peer->getID()] = peer;
                     peersGuard.unlock();
 					peer->setNextPeerId(nextPeerId); //Set next peer ID again, because otherwise it cannot be saved.
-					updatePeerAddresses();
+					updatePeerAddresses(false, peer->getID());
 				}
 				catch(const std::exception& ex)
 				{
@@ -659,7 +883,7 @@ std::string MyCentral::handleCliCommand(std::string command)
 				PMyPeer nextPeer;
 				if(nextPeerId != 0) nextPeer = getPeer(nextPeerId);
 				peer->setNextPeerId(nextPeerId);
-				updatePeerAddresses();
+				updatePeerAddresses(false, peerId);
 				stringStream << "NEXT_PEER_ID of peer " << peerId << " was set to " << nextPeerId << ".";
 				if(nextPeerId != 0) stringStream << " Address (= bit position) of peer " << nextPeerId << " now is " << nextPeer->getAddress() << ".";
 				stringStream << std::endl;
@@ -681,8 +905,8 @@ std::string MyCentral::handleCliCommand(std::string command)
             }
 
             std::string interfaceId = arguments.at(0);
-            uint16_t startBit = BaseLib::Math::getNumber(arguments.at(1));
-            uint16_t endBit = BaseLib::Math::getNumber(arguments.at(2));
+            uint32_t startBit = BaseLib::Math::getUnsignedNumber(arguments.at(1));
+            uint32_t endBit = BaseLib::Math::getUnsignedNumber(arguments.at(2));
             std::vector<uint16_t> data;
             auto bytes = _bl->hf.getUBinary(arguments.at(3));
             data.resize(bytes.size() / 2 + (bytes.size() % 2 ? 1 : 0));
@@ -736,6 +960,68 @@ std::string MyCentral::handleCliCommand(std::string command)
 
             stringStream << BaseLib::HelperFunctions::getHexString(interfaceIterator->second->getWriteBuffer()) << std::endl;
 
+            return stringStream.str();
+        }
+        else if(BaseLib::HelperFunctions::checkCliCommand(command, "interfacestatus", "", "", 1, arguments, showHelp))
+        {
+            if(showHelp)
+            {
+                stringStream << "Description: This command prints status information and counters of an interface." << std::endl;
+                stringStream << "Usage: interfacestatus INTERFACE" << std::endl << std::endl;
+                stringStream << "Parameters:" << std::endl;
+                stringStream << "  INTERFACE: The interface to print the status for. Example: My-BK9000" << std::endl;
+                return stringStream.str();
+            }
+
+            std::string interfaceId = arguments.at(0);
+            auto interfaceIterator = GD::physicalInterfaces.find(interfaceId);
+            if(interfaceIterator == GD::physicalInterfaces.end()) return "Unknown interface.\n";
+
+            stringStream << "Connected:       " << (interfaceIterator->second->isOpen() ? "yes" : "no") << std::endl;
+            stringStream << "Cycles:          " << interfaceIterator->second->getMessageCounter() << std::endl;
+            stringStream << "Dropped images:  " << interfaceIterator->second->getDroppedImages() << std::endl;
+            stringStream << "Dropped values:  " << interfaceIterator->second->getDroppedValues() << std::endl;
+            stringStream << "Coupler status:  0x" << BaseLib::HelperFunctions::getHexString(interfaceIterator->second->getBusCouplerStatus(), 4) << std::endl;
+            stringStream << "Coupler diag:    0x" << BaseLib::HelperFunctions::getHexString(interfaceIterator->second->getBusCouplerDiag(), 4) << std::endl;
+            if(interfaceIterator->second->isRecording()) stringStream << "Dropped records: " << interfaceIterator->second->getDroppedRecords() << std::endl;
+            if(interfaceIterator->second->getInterlockRuleCount() > 0) stringStream << "Interlock rules: " << interfaceIterator->second->getInterlockRuleCount() << std::endl;
+            if(interfaceIterator->second->isLoadSheddingEnabled())
+            {
+                stringStream << "Cycle time:      " << interfaceIterator->second->getAverageCycleTime() << " us" << std::endl;
+                stringStream << "Load shedding:   tier " << interfaceIterator->second->getLoadSheddingTier() << std::endl;
+            }
+
+            return stringStream.str();
+        }
+        else if(BaseLib::HelperFunctions::checkCliCommand(command, "history", "", "", 1, arguments, showHelp))
+        {
+            if(showHelp)
+            {
+                stringStream << "Description: This command prints the recorded input and output images of an interface." << std::endl;
+                stringStream << "Usage: history INTERFACE [MILLISECONDS] [STARTREGISTER] [REGISTERCOUNT]" << std::endl << std::endl;
+                stringStream << "Parameters:" << std::endl;
+                stringStream << "  INTERFACE:     The interface to print the history for. Example: My-BK9000" << std::endl;
+                stringStream << "  MILLISECONDS:  The time span to print. Default: 1000" << std::endl;
+                stringStream << "  STARTREGISTER: The first register to print. Default: 0" << std::endl;
+                stringStream << "  REGISTERCOUNT: The number of registers to print. Default: All" << std::endl;
+                return stringStream.str();
+            }
+
+            std::string interfaceId = arguments.at(0);
+            auto interfaceIterator = GD::physicalInterfaces.find(interfaceId);
+            if(interfaceIterator == GD::physicalInterfaces.end()) return "Unknown interface.\n";
+
+            int64_t timeSpan = arguments.size() > 1 ? BaseLib::Math::getNumber64(arguments.at(1)) : 1000;
+            uint32_t startRegister = arguments.size() > 2 ? BaseLib::Math::getUnsignedNumber(arguments.at(2)) : 0;
+            uint32_t registerCount = arguments.size() > 3 ? BaseLib::Math::getUnsignedNumber(arguments.at(3)) : 0xFFFFFFFF;
+
+            int64_t endTime = BaseLib::HelperFunctions::getTime();
+            auto history = interfaceIterator->second->getHistory(endTime - timeSpan, endTime, startRegister, registerCount);
+            for(auto& processImage : history)
+            {
+                stringStream << processImage.time << " I " << BaseLib::HelperFunctions::getHexString(processImage.inputs) << " O " << BaseLib::HelperFunctions::getHexString(processImage.outputs) << std::endl;
+            }
+
             return stringStream.str();
         }
 		else return "Unknown command.\n";
@@ -767,151 +1053,325 @@ std::shared_ptr<MyPeer> MyCentral::createPeer(uint32_t type, int32_t address, st
     return std::shared_ptr<MyPeer>();
 }
 
-void MyCentral::updatePeerAddresses(bool booting)
+std::vector<PMyPeer> MyCentral::updateAddressChain(const std::string& interfaceId, std::unordered_map<uint64_t, PMyPeer>& peers, uint64_t changedPeerId)
 {
+	std::vector<PMyPeer> chain;
 	try
 	{
-		struct Pots
-		{
-			uint64_t firstPeer = 0;
-			uint32_t analogInputBits = 0;
-			uint32_t analogOutputBits = 0;
-			uint32_t digitalInputBits = 0;
-			uint32_t digitalOutputBits = 0;
-			std::list<PMyPeer> analogInputs;
-			std::list<PMyPeer> digitalInputs;
-			std::list<PMyPeer> analogOutputs;
-			std::list<PMyPeer> digitalOutputs;
-		};
-		typedef std::shared_ptr<Pots> PPots;
-
-		std::unordered_map<std::string, uint64_t> firstPeers;
-		std::unordered_map<std::string, std::set<uint64_t>> interfacePeers;
-		std::unordered_map<std::string, uint32_t> peersWithoutAddress;
+		chain.reserve(peers.size());
+		std::vector<uint64_t>& cachedChain = _addressChains[interfaceId];
 
+		//{{{ Reuse the part of the chain in front of the modified peer
+		if(changedPeerId != 0)
 		{
-			std::lock_guard<std::mutex> peersGuard(_peersMutex);
-
-			for(auto& peer : _peersById)
+			for(auto peerId : cachedChain)
 			{
-				PMyPeer myPeer = std::dynamic_pointer_cast<MyPeer>(peer.second);
-				if(!myPeer) continue;
-				if(myPeer->getNextPeerId() == myPeer->getID())
-				{
-					GD::out.printCritical("Critical: Peer " + std::to_string(myPeer->getID()) + " points to itself. Please set NEXT_PEER_ID to a valid value.");
-					continue;
-				}
-                auto firstPeersIterator = firstPeers.find(myPeer->getPhysicalInterface()->getID());
-                if(firstPeersIterator == firstPeers.end()) firstPeersIterator = firstPeers.emplace(myPeer->getPhysicalInterface()->getID(), 0).first;
-				if(myPeer->getNextPeerId() > 0 && myPeer->getNextPeerId() == firstPeersIterator->second)
+				auto peerIterator = peers.find(peerId);
+				if(peerIterator == peers.end() || (!chain.empty() && chain.back()->getNextPeerId() != peerId))
 				{
-					if(interfacePeers[myPeer->getPhysicalInterface()->getID()].find(myPeer->getID()) == interfacePeers[myPeer->getPhysicalInterface()->getID()].end())
-					{
-						firstPeers[myPeer->getPhysicalInterface()->getID()] = myPeer->getID();
-					}
-					else
-					{
-						firstPeers[myPeer->getPhysicalInterface()->getID()] = 0;
-					}
+					//Cached chain is outdated
+					chain.clear();
+					break;
 				}
-				else if(firstPeersIterator->second == 0) firstPeers[myPeer->getPhysicalInterface()->getID()] = myPeer->getID();
-				if(myPeer->getNextPeerId() > 0) interfacePeers[myPeer->getPhysicalInterface()->getID()].emplace(myPeer->getNextPeerId());
-				else
+				chain.push_back(peerIterator->second);
+				if(peerId == changedPeerId) break;
+			}
+			if(!chain.empty() && chain.back()->getID() != changedPeerId) chain.clear();
+		}
+		//}}}
+
+		bool chainReused = !chain.empty();
+		if(!chainReused)
+		{
+			//{{{ Find first peer, i. e. the peer no other peer of this interface points to
+			std::unordered_set<uint64_t> nextPeerIds;
+			nextPeerIds.reserve(peers.size());
+			for(auto& peer : peers)
+			{
+				if(peer.second->getNextPeerId() == peer.first)
 				{
-					auto peersWithoutAddressIterator = peersWithoutAddress.find(myPeer->getPhysicalInterface()->getID());
-					if(peersWithoutAddressIterator == peersWithoutAddress.end()) peersWithoutAddress.emplace(myPeer->getPhysicalInterface()->getID(), 1);
-					else peersWithoutAddressIterator->second++;
+					GD::out.printCritical("Critical: Peer " + std::to_string(peer.first) + " points to itself. Please set NEXT_PEER_ID to a valid value.");
+					continue;
 				}
+				if(peer.second->getNextPeerId() > 0) nextPeerIds.emplace(peer.second->getNextPeerId());
 			}
 
-			for(auto& element : firstPeers) //Find first peer, if not found yet
+			PMyPeer firstPeer;
+			for(auto& peer : peers)
 			{
-				if(element.second == 0)
+				if(peer.second->getNextPeerId() == peer.first || nextPeerIds.find(peer.first) != nextPeerIds.end()) continue;
+				//Prefer peers starting a chain over peers with an unset NEXT_PEER_ID. Use the smallest ID for stable results.
+				if(!firstPeer ||
+					(firstPeer->getNextPeerId() == 0 && peer.second->getNextPeerId() != 0) ||
+					((firstPeer->getNextPeerId() == 0) == (peer.second->getNextPeerId() == 0) && peer.first < firstPeer->getID()))
 				{
-					for(auto& peer : _peersById)
-					{
-						if(interfacePeers[element.first].find(peer.first) == interfacePeers[element.first].end())
-						{
-							element.second = peer.first;
-							break;
-						}
-					}
+					firstPeer = peer.second;
 				}
 			}
+			//}}}
+
+			if(!firstPeer)
+			{
+				if(!peers.empty()) GD::out.printCritical("Critical: Address loop detected on interface " + interfaceId + ". Please check NEXT_PEER_ID of all peers.");
+				cachedChain.clear();
+				return chain;
+			}
+			chain.push_back(firstPeer);
 		}
 
-		for(auto& element : firstPeers)
+		std::unordered_set<uint64_t> visitedPeers;
+		visitedPeers.reserve(peers.size());
+		for(auto& peer : chain)
 		{
-			if(element.second == 0)
+			visitedPeers.emplace(peer->getID());
+		}
+
+		PMyPeer peer = chain.back();
+		while(peer->getNextPeerId() != 0)
+		{
+			if(peer->getNextPeerId() == peer->getID())
 			{
-				if(interfacePeers[element.first].size() > 1) GD::out.printCritical("Critical: Address loop detected on interface " + element.first + ". Please check NEXT_PEER_ID of all peers.");
-				continue;
+				//Already reported while searching the first peer, when the chain wasn't reused.
+				if(chainReused) GD::out.printCritical("Critical: Peer " + std::to_string(peer->getID()) + " points to itself. Please set NEXT_PEER_ID to a valid value.");
+				break;
 			}
 
-			PPots currentPots = std::make_shared<Pots>();
-			currentPots->firstPeer = element.second;
-
-			PMyPeer peer = getPeer(element.second);
-			if(!peer)
+			auto nextPeerIterator = peers.find(peer->getNextPeerId());
+			if(nextPeerIterator == peers.end())
 			{
-				GD::out.printCritical("Critical: Can't find first peer and can't generate addresses for interface " + element.first + ". Please recheck NEXT_PEER_ID of all peers.");
-				continue;
+				if(peerExists(peer->getNextPeerId())) GD::out.printCritical("Critical: Peer " + std::to_string(peer->getID()) + " points to peer " + std::to_string(peer->getNextPeerId()) + ", but the two peers are connected to different interfaces.");
+				else GD::out.printCritical("Critical: Peer " + std::to_string(peer->getID()) + " points to peer " + std::to_string(peer->getNextPeerId()) + ", which doesn't exist or isn't a Beckhoff peer.");
+				break;
 			}
-			if(peer->isAnalog())
+			if(!visitedPeers.emplace(nextPeerIterator->first).second)
 			{
-				if(peer->getOutputMemorySize() > 0) currentPots->analogOutputs.push_back(peer);
-				if(peer->getInputMemorySize() > 0) currentPots->analogInputs.push_back(peer);
+				GD::out.printCritical("Critical: Address loop detected on interface " + interfaceId + " at peer " + std::to_string(peer->getID()) + ". Please check NEXT_PEER_ID of all peers.");
+				break;
 			}
-			else
+
+			peer = nextPeerIterator->second;
+			chain.push_back(peer);
+		}
+
+		cachedChain.clear();
+		cachedChain.reserve(chain.size());
+		for(auto& peer : chain)
+		{
+			cachedChain.push_back(peer->getID());
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return chain;
+}
+
+void MyCentral::updateInputPeers()
+{
+	try
+	{
+		std::unordered_map<std::string, std::shared_ptr<std::vector<PMyPeer>>> inputPeers;
+		for(auto& interfacePeers : _interfacePeers)
+		{
+			inputPeers.emplace(interfacePeers.first, std::make_shared<std::vector<PMyPeer>>());
+		}
+
+		{
+			std::lock_guard<std::mutex> peersGuard(_peersMutex);
+			for(auto& peer : _peersById)
 			{
-                if(peer->getOutputMemorySize() > 0) currentPots->digitalOutputs.push_back(peer);
-                if(peer->getInputMemorySize() > 0) currentPots->digitalInputs.push_back(peer);
+				PMyPeer myPeer = std::dynamic_pointer_cast<MyPeer>(peer.second);
+				if(!myPeer || myPeer->deleting || myPeer->isOutputDevice() || !myPeer->getPhysicalInterface()) continue;
+				auto inputPeersIterator = inputPeers.find(myPeer->getPhysicalInterface()->getID());
+				if(inputPeersIterator == inputPeers.end()) continue;
+				inputPeersIterator->second->push_back(myPeer);
 			}
-			currentPots->analogInputBits = peer->getPhysicalInterface()->analogInputBits();
-			currentPots->analogOutputBits = peer->getPhysicalInterface()->analogOutputBits();
-			currentPots->digitalInputBits = peer->getPhysicalInterface()->digitalInputBits();
-			currentPots->digitalOutputBits = peer->getPhysicalInterface()->digitalOutputBits();
+		}
 
-			uint32_t usedAnalogInputBits = 0;
-			uint32_t usedAnalogOutputBits = 0;
-			uint32_t usedDigitalInputBits = 0;
-			uint32_t usedDigitalOutputBits = 0;
+		for(auto& interfacePeers : _interfacePeers)
+		{
+			std::lock_guard<std::mutex> inputPeersGuard(interfacePeers.second->inputPeersMutex);
+			interfacePeers.second->inputPeers = inputPeers.at(interfacePeers.first);
+		}
+
+		updateReadPlans();
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
 
-			int32_t maxIterations = interfacePeers[element.first].size() + 1;
-			for(int32_t i = 0; i < maxIterations; i++) //Limit number of iterations
+std::vector<MainInterface::ReadRange> MyCentral::planReads(const std::vector<int32_t>& registerIntervals, uint32_t gapThreshold)
+{
+	std::vector<MainInterface::ReadRange> readPlan;
+	try
+	{
+		//Consecutive used registers with the same interval form one range.
+		std::map<int32_t, std::vector<MainInterface::ReadRange>> rangesByInterval;
+		for(uint32_t i = 0; i < registerIntervals.size(); i++)
+		{
+			int32_t interval = registerIntervals[i];
+			if(interval == -1) continue;
+			auto& ranges = rangesByInterval[interval];
+			if(!ranges.empty() && ranges.back().startRegister + ranges.back().registerCount == i) ranges.back().registerCount++;
+			else
 			{
-				if(peer->getNextPeerId() == 0) break;
+				MainInterface::ReadRange range;
+				range.startRegister = i;
+				range.registerCount = 1;
+				range.interval = interval;
+				ranges.push_back(range);
+			}
+		}
 
-				PMyPeer nextPeer = getPeer(peer->getNextPeerId());
-				if(!nextPeer)
+		//Ranges with the same interval are merged when the gap between them is small enough. Reading a few unneeded
+		//registers is cheaper than an additional request.
+		for(auto& ranges : rangesByInterval)
+		{
+			for(auto& range : ranges.second)
+			{
+				if(!readPlan.empty() && readPlan.back().interval == range.interval && range.startRegister - (readPlan.back().startRegister + readPlan.back().registerCount) <= gapThreshold)
 				{
-					GD::out.printCritical("Critical: Peer " + std::to_string(peer->getID()) + " points to peer " + std::to_string(peer->getNextPeerId()) + ", which doesn't exist or isn't a Beckhoff peer.");
-					continue;
+					readPlan.back().registerCount = range.startRegister + range.registerCount - readPlan.back().startRegister;
 				}
-				if(nextPeer->getPhysicalInterface()->getID() != peer->getPhysicalInterface()->getID())
+				else readPlan.push_back(range);
+			}
+		}
+
+		//Ranges completely covered by a range read at least as often don't need to be read on their own. rangesByInterval
+		//is ordered, so faster ranges come first.
+		std::vector<MainInterface::ReadRange> coveredRanges;
+		coveredRanges.reserve(readPlan.size());
+		for(auto& range : readPlan)
+		{
+			bool covered = false;
+			for(auto& fasterRange : coveredRanges)
+			{
+				if(fasterRange.interval > range.interval) break;
+				if(fasterRange.startRegister <= range.startRegister && fasterRange.startRegister + fasterRange.registerCount >= range.startRegister + range.registerCount)
 				{
-					GD::out.printCritical("Critical: Peer " + std::to_string(peer->getID()) + " points to peer " + std::to_string(nextPeer->getID()) + ", but the two peers are connected to different interfaces.");
-					continue;
+					covered = true;
+					break;
 				}
+			}
+			if(!covered) coveredRanges.push_back(range);
+		}
+		readPlan.swap(coveredRanges);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return readPlan;
+}
+
+void MyCentral::updateReadPlans()
+{
+	try
+	{
+		for(auto& interfacePeers : _interfacePeers)
+		{
+			auto interfaceIterator = GD::physicalInterfaces.find(interfacePeers.first);
+			if(interfaceIterator == GD::physicalInterfaces.end()) continue;
+			std::shared_ptr<MainInterface>& physicalInterface = interfaceIterator->second;
+
+			std::shared_ptr<std::vector<PMyPeer>> inputPeers;
+			{
+				std::lock_guard<std::mutex> inputPeersGuard(interfacePeers.second->inputPeersMutex);
+				inputPeers = interfacePeers.second->inputPeers;
+			}
+			if(!inputPeers) continue;
+
+			//Shortest poll interval of every input register. -1 marks registers no peer uses.
+			std::vector<int32_t> registerIntervals;
+			for(auto& peer : *inputPeers)
+			{
+				int32_t memorySize = peer->getInputMemorySize();
+				if(memorySize <= 0) continue;
+				uint32_t startRegister = peer->getInputAddress() / 16;
+				uint32_t endRegister = (peer->getInputAddress() + memorySize - 1) / 16;
+				if(endRegister >= registerIntervals.size()) registerIntervals.resize(endRegister + 1, -1);
+				int32_t interval = peer->getPollInterval();
+				for(uint32_t i = startRegister; i <= endRegister; i++)
+				{
+					if(registerIntervals[i] == -1 || interval < registerIntervals[i]) registerIntervals[i] = interval;
+				}
+			}
+
+			std::vector<MainInterface::ReadRange> readPlan = planReads(registerIntervals, _readGapThreshold);
+			physicalInterface->setReadPlan(readPlan);
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MyCentral::updatePeerAddresses(bool booting, uint64_t changedPeerId)
+{
+	try
+	{
+		std::unordered_map<std::string, std::unordered_map<uint64_t, PMyPeer>> interfacePeers;
+		std::string changedInterfaceId;
 
-				if(nextPeer->isAnalog())
+		{
+			std::lock_guard<std::mutex> peersGuard(_peersMutex);
+			for(auto& peer : _peersById)
+			{
+				PMyPeer myPeer = std::dynamic_pointer_cast<MyPeer>(peer.second);
+				if(!myPeer || !myPeer->getPhysicalInterface()) continue;
+				std::string interfaceId = myPeer->getPhysicalInterface()->getID();
+				if(peer.first == changedPeerId) changedInterfaceId = interfaceId;
+				interfacePeers[interfaceId].emplace(peer.first, myPeer);
+			}
+		}
+
+		std::lock_guard<std::mutex> addressChainsGuard(_addressChainsMutex);
+		for(auto& element : interfacePeers)
+		{
+			//Only the interface of the modified peer needs to be updated
+			if(!changedInterfaceId.empty() && element.first != changedInterfaceId) continue;
+
+			std::vector<PMyPeer> chain = updateAddressChain(element.first, element.second, changedPeerId);
+			if(chain.empty()) continue;
+
+			std::vector<PMyPeer> analogInputs;
+			std::vector<PMyPeer> digitalInputs;
+			std::vector<PMyPeer> analogOutputs;
+			std::vector<PMyPeer> digitalOutputs;
+			for(auto& peer : chain)
+			{
+				if(peer->isAnalog())
 				{
-                    if(nextPeer->getOutputMemorySize() > 0) currentPots->analogOutputs.push_back(nextPeer);
-                    if(nextPeer->getInputMemorySize() > 0) currentPots->analogInputs.push_back(nextPeer);
+					if(peer->getOutputMemorySize() > 0) analogOutputs.push_back(peer);
+					if(peer->getInputMemorySize() > 0) analogInputs.push_back(peer);
 				}
 				else
 				{
-                    if(nextPeer->getOutputMemorySize() > 0) currentPots->digitalOutputs.push_back(nextPeer);
-                    if(nextPeer->getInputMemorySize() > 0) currentPots->digitalInputs.push_back(nextPeer);
+					if(peer->getOutputMemorySize() > 0) digitalOutputs.push_back(peer);
+					if(peer->getInputMemorySize() > 0) digitalInputs.push_back(peer);
 				}
-
-				peer = nextPeer;
 			}
 
+			auto& physicalInterface = chain.front()->getPhysicalInterface();
+			uint32_t analogInputBits = physicalInterface->analogInputBits();
+			uint32_t analogOutputBits = physicalInterface->analogOutputBits();
+			uint32_t digitalInputBits = physicalInterface->digitalInputBits();
+			uint32_t digitalOutputBits = physicalInterface->digitalOutputBits();
+
+			uint32_t usedAnalogInputBits = 0;
+			uint32_t usedAnalogOutputBits = 0;
+			uint32_t usedDigitalInputBits = 0;
+			uint32_t usedDigitalOutputBits = 0;
+
+			//The setters only persist addresses that actually changed.
 			uint32_t currentAddress = 0;
-			for(auto& peer : currentPots->analogInputs)
+			for(auto& peer : analogInputs)
 			{
-				if(currentAddress + peer->getInputMemorySize() > currentPots->analogInputBits && !booting)
+				if(currentAddress + peer->getInputMemorySize() > analogInputBits && !booting)
 				{
 					GD::out.printError("Error: The calculated address of peer " + std::to_string(peer->getID()) + " exceeds number of analog input bits returned by interface " + element.first + ". Recheck that the cards configured in Homegear mirror the actually installed devices.");
 				}
@@ -920,9 +1380,9 @@ void MyCentral::updatePeerAddresses(bool booting)
 				usedAnalogInputBits += peer->getInputMemorySize();
 			}
 
-			for(auto& peer : currentPots->digitalInputs)
+			for(auto& peer : digitalInputs)
 			{
-				if(currentAddress + peer->getInputMemorySize() > currentPots->analogInputBits + currentPots->digitalInputBits && !booting)
+				if(currentAddress + peer->getInputMemorySize() > analogInputBits + digitalInputBits && !booting)
 				{
 					GD::out.printError("Error: The calculated address of peer " + std::to_string(peer->getID()) + " exceeds number of digital input bits returned by interface " + element.first + ". Recheck that the cards configured in Homegear mirror the actually installed devices.");
 				}
@@ -932,9 +1392,9 @@ void MyCentral::updatePeerAddresses(bool booting)
 			}
 
 			currentAddress = 0;
-			for(auto& peer : currentPots->analogOutputs)
+			for(auto& peer : analogOutputs)
 			{
-				if(currentAddress + peer->getOutputMemorySize() > currentPots->analogOutputBits && !booting)
+				if(currentAddress + peer->getOutputMemorySize() > analogOutputBits && !booting)
 				{
 					GD::out.printError("Error: The calculated address of peer " + std::to_string(peer->getID()) + " exceeds number of analog output bits returned by interface " + element.first + ". Recheck that the cards configured in Homegear mirror the actually installed devices.");
 				}
@@ -943,9 +1403,9 @@ void MyCentral::updatePeerAddresses(bool booting)
 				usedAnalogOutputBits += peer->getOutputMemorySize();
 			}
 
-			for(auto& peer : currentPots->digitalOutputs)
+			for(auto& peer : digitalOutputs)
 			{
-				if(currentAddress + peer->getOutputMemorySize() > currentPots->analogOutputBits + currentPots->digitalOutputBits && !booting)
+				if(currentAddress + peer->getOutputMemorySize() > analogOutputBits + digitalOutputBits && !booting)
 				{
 					GD::out.printError("Error: The calculated address of peer " + std::to_string(peer->getID()) + " exceeds number of digital output bits returned by interface " + element.first + ". Recheck that the cards configured in Homegear mirror the actually installed devices.");
 				}
@@ -954,17 +1414,25 @@ void MyCentral::updatePeerAddresses(bool booting)
 				usedDigitalOutputBits += peer->getOutputMemorySize();
 			}
 
-			if(peersWithoutAddress[element.first] > 1)
+			uint32_t peersWithoutAddress = 0;
+			for(auto& peer : element.second)
 			{
-				GD::out.printWarning("Warning: " + std::to_string(peersWithoutAddress[element.first] - 1) + " peer(s) on interface " + element.first + " have/has an unset NEXT_PEER_ID. Please complete the peer configuration.");
+				if(peer.second->getNextPeerId() == 0) peersWithoutAddress++;
+			}
+
+			if(peersWithoutAddress > 1)
+			{
+				GD::out.printWarning("Warning: " + std::to_string(peersWithoutAddress - 1) + " peer(s) on interface " + element.first + " have/has an unset NEXT_PEER_ID. Please complete the peer configuration.");
 			}
 			else if(!booting)
 			{
-				if(usedAnalogInputBits + usedAnalogOutputBits < currentPots->analogInputBits) GD::out.printWarning("Warning: Interface " + element.first + " returned " + std::to_string(currentPots->analogInputBits) + " analog input and output bits but only " + std::to_string(usedAnalogInputBits + usedAnalogOutputBits) + " are used.");
-				if(usedDigitalInputBits < currentPots->digitalInputBits) GD::out.printWarning("Warning: Interface " + element.first + " returned " + std::to_string(currentPots->digitalInputBits) + " digital input bits but only " + std::to_string(usedDigitalInputBits) + " are used.");
-				if(usedDigitalOutputBits < currentPots->digitalOutputBits) GD::out.printWarning("Warning: Interface " + element.first + " returned " + std::to_string(currentPots->digitalOutputBits) + " digital output bits but only " + std::to_string(usedDigitalOutputBits) + " are used.");
+				if(usedAnalogInputBits + usedAnalogOutputBits < analogInputBits) GD::out.printWarning("Warning: Interface " + element.first + " returned " + std::to_string(analogInputBits) + " analog input and output bits but only " + std::to_string(usedAnalogInputBits + usedAnalogOutputBits) + " are used.");
+				if(usedDigitalInputBits < digitalInputBits) GD::out.printWarning("Warning: Interface " + element.first + " returned " + std::to_string(digitalInputBits) + " digital input bits but only " + std::to_string(usedDigitalInputBits) + " are used.");
+				if(usedDigitalOutputBits < digitalOutputBits) GD::out.printWarning("Warning: Interface " + element.first + " returned " + std::to_string(digitalOutputBits) + " digital output bits but only " + std::to_string(usedDigitalOutputBits) + " are used.");
 			}
 		}
+
+		updateInputPeers();
 	}
 	catch(const std::exception& ex)
 	{
@@ -989,6 +1457,7 @@ PVariable MyCentral::createDevice(BaseLib::PRpcClientInfo clientInfo, int32_t de
 			peer->save(true, true, false);
 			peer->initializeCentralConfig();
 			peer->setPhysicalInterfaceId(interfaceId);
+			peer->updateCaches();
 
             {
                 std::lock_guard<std::mutex> peersGuard(_peersMutex);
@@ -996,7 +1465,7 @@ PVariable MyCentral::createDevice(BaseLib::PRpcClientInfo clientInfo, int32_t de
                 _peersBySerial[peer->getSerialNumber()] = peer;
             }
 
-			updatePeerAddresses();
+			updatePeerAddresses(false, peer->getID());
 		}
 		catch(const std::exception& ex)
 		{
@@ -1019,6 +1488,187 @@ PVariable MyCentral::createDevice(BaseLib::PRpcClientInfo clientInfo, int32_t de
     return Variable::createError(-32500, "Unknown application error.");
 }
 
+PVariable MyCentral::createDevices(const BaseLib::PRpcClientInfo& clientInfo, const BaseLib::PArray& parameters)
+{
+	try
+	{
+		if(parameters->size() != 2 && parameters->size() != 3) return Variable::createError(-1, "Wrong parameter count.");
+		if(parameters->at(0)->type != VariableType::tString) return Variable::createError(-1, "Parameter 1 is not of type String.");
+		if(parameters->at(1)->type != VariableType::tArray) return Variable::createError(-1, "Parameter 2 is not of type Array.");
+		if(parameters->size() == 3 && parameters->at(2)->type != VariableType::tInteger && parameters->at(2)->type != VariableType::tInteger64) return Variable::createError(-1, "Parameter 3 is not of type Integer.");
+
+		std::string interfaceId = parameters->at(0)->stringValue;
+		if(GD::physicalInterfaces.find(interfaceId) == GD::physicalInterfaces.end()) return Variable::createError(-6, "Unknown physical interface.");
+		uint64_t lastNextPeerId = parameters->size() == 3 ? (uint64_t)parameters->at(2)->integerValue64 : 0;
+		if(lastNextPeerId != 0 && !peerExists(lastNextPeerId)) return Variable::createError(-2, "Unknown next peer.");
+
+		//{{{ Validate everything before creating the first peer
+		std::vector<std::pair<int32_t, std::string>> devices;
+		devices.reserve(parameters->at(1)->arrayValue->size());
+		std::unordered_set<std::string> serialNumbers;
+		for(auto& device : *parameters->at(1)->arrayValue)
+		{
+			if(device->type != VariableType::tStruct) return Variable::createError(-1, "Array elements need to be of type Struct.");
+			auto deviceTypeIterator = device->structValue->find("deviceType");
+			auto serialNumberIterator = device->structValue->find("serialNumber");
+			if(deviceTypeIterator == device->structValue->end() || serialNumberIterator == device->structValue->end()) return Variable::createError(-1, "Every device needs \"deviceType\" and \"serialNumber\".");
+			int32_t deviceType = deviceTypeIterator->second->integerValue;
+			std::string serialNumber = serialNumberIterator->second->stringValue;
+			if(serialNumber.size() < 10 || serialNumber.size() > 12) return Variable::createError(-1, "The serial number needs to have a size between 10 and 12: " + serialNumber);
+			if(peerExists(serialNumber) || !serialNumbers.emplace(serialNumber).second) return Variable::createError(-5, "A peer with this serial number is already paired to this central: " + serialNumber);
+			if(!GD::family->getRpcDevices()->find(deviceType, 0x10, -1)) return Variable::createError(-6, "Unknown device type: 0x" + BaseLib::HelperFunctions::getHexString(deviceType));
+			devices.emplace_back(deviceType, serialNumber);
+		}
+		if(devices.empty()) return std::make_shared<Variable>(VariableType::tArray);
+		//}}}
+
+		std::vector<std::shared_ptr<MyPeer>> peers;
+		peers.reserve(devices.size());
+		for(auto& device : devices)
+		{
+			std::shared_ptr<MyPeer> peer = createPeer(device.first, 0, device.second, false);
+			if(!peer || !peer->getRpcDevice())
+			{
+				//The NEXT_PEER_ID chain and the returned IDs need to match the passed list, so nothing is created.
+				for(auto& createdPeer : peers)
+				{
+					createdPeer->dispose();
+					createdPeer->deleteFromDatabase();
+				}
+				return Variable::createError(-32500, "Could not create peer " + device.second + ". No peer was created. See log for more details.");
+			}
+			peer->save(true, true, false);
+			peer->initializeCentralConfig();
+			peer->setPhysicalInterfaceId(interfaceId);
+			peer->updateCaches();
+			peers.push_back(peer);
+		}
+		//NEXT_PEER_ID can only be set once the IDs are known
+		for(uint32_t i = 0; i < peers.size(); i++)
+		{
+			peers.at(i)->setNextPeerId(i + 1 < peers.size() ? peers.at(i + 1)->getID() : lastNextPeerId);
+		}
+
+		{
+			std::lock_guard<std::mutex> peersGuard(_peersMutex);
+			for(auto& peer : peers)
+			{
+				_peersById[peer->getID()] = peer;
+				_peersBySerial[peer->getSerialNumber()] = peer;
+			}
+		}
+
+		updatePeerAddresses(false, peers.front()->getID());
+
+		PVariable deviceDescriptions(new Variable(VariableType::tArray));
+		std::vector<uint64_t> newIds;
+		newIds.reserve(peers.size());
+		PVariable result = std::make_shared<Variable>(VariableType::tArray);
+		result->arrayValue->reserve(peers.size());
+		for(auto& peer : peers)
+		{
+			PArray descriptions = peer->getDeviceDescriptions(clientInfo, true, std::map<std::string, bool>());
+			deviceDescriptions->arrayValue->insert(deviceDescriptions->arrayValue->end(), descriptions->begin(), descriptions->end());
+			newIds.push_back(peer->getID());
+			result->arrayValue->push_back(std::make_shared<Variable>((uint32_t)peer->getID()));
+		}
+		raiseRPCNewDevices(newIds, deviceDescriptions);
+		GD::out.printMessage("Added " + std::to_string(peers.size()) + " peers to interface " + interfaceId + ".");
+
+		return result;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return Variable::createError(-32500, "Unknown application error.");
+}
+
+PVariable MyCentral::deleteDevices(const BaseLib::PRpcClientInfo& clientInfo, const BaseLib::PArray& parameters)
+{
+	try
+	{
+		if(parameters->size() != 1) return Variable::createError(-1, "Wrong parameter count.");
+		if(parameters->at(0)->type != VariableType::tArray) return Variable::createError(-1, "Parameter 1 is not of type Array.");
+
+		std::vector<uint64_t> ids;
+		ids.reserve(parameters->at(0)->arrayValue->size());
+		for(auto& element : *parameters->at(0)->arrayValue)
+		{
+			if(element->type != VariableType::tInteger && element->type != VariableType::tInteger64) return Variable::createError(-1, "Array elements need to be of type Integer.");
+			uint64_t peerId = (uint64_t)element->integerValue64;
+			if(peerId == 0 || !peerExists(peerId)) continue;
+			ids.push_back(peerId);
+		}
+
+		deletePeers(ids);
+
+		for(auto id : ids)
+		{
+			if(peerExists(id)) return Variable::createError(-1, "Error deleting peer " + std::to_string(id) + ". See log for more details.");
+		}
+
+		return std::make_shared<Variable>(VariableType::tVoid);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return Variable::createError(-32500, "Unknown application error.");
+}
+
+PVariable MyCentral::getProcessImageHistory(const BaseLib::PRpcClientInfo& clientInfo, const BaseLib::PArray& parameters)
+{
+	try
+	{
+		if(parameters->size() != 3 && parameters->size() != 5) return Variable::createError(-1, "Wrong parameter count.");
+		if(parameters->at(0)->type != VariableType::tString) return Variable::createError(-1, "Parameter 1 is not of type String.");
+		for(uint32_t i = 1; i < parameters->size(); i++)
+		{
+			if(parameters->at(i)->type != VariableType::tInteger && parameters->at(i)->type != VariableType::tInteger64) return Variable::createError(-1, "Parameter " + std::to_string(i + 1) + " is not of type Integer.");
+		}
+
+		auto interfaceIterator = GD::physicalInterfaces.find(parameters->at(0)->stringValue);
+		if(interfaceIterator == GD::physicalInterfaces.end()) return Variable::createError(-6, "Unknown physical interface.");
+
+		uint32_t startRegister = 0;
+		uint32_t registerCount = 0xFFFFFFFF;
+		if(parameters->size() == 5)
+		{
+			if(parameters->at(3)->integerValue64 < 0 || parameters->at(4)->integerValue64 < 0) return Variable::createError(-1, "Register numbers must not be negative.");
+			startRegister = parameters->at(3)->integerValue64;
+			registerCount = parameters->at(4)->integerValue64;
+		}
+
+		auto history = interfaceIterator->second->getHistory(parameters->at(1)->integerValue64, parameters->at(2)->integerValue64, startRegister, registerCount);
+
+		PVariable result = std::make_shared<Variable>(VariableType::tArray);
+		result->arrayValue->reserve(history.size());
+		for(auto& processImage : history)
+		{
+			PVariable entry = std::make_shared<Variable>(VariableType::tStruct);
+			PVariable inputs = std::make_shared<Variable>(VariableType::tArray);
+			inputs->arrayValue->reserve(processImage.inputs.size());
+			for(auto value : processImage.inputs) inputs->arrayValue->push_back(std::make_shared<Variable>((int32_t)value));
+			PVariable outputs = std::make_shared<Variable>(VariableType::tArray);
+			outputs->arrayValue->reserve(processImage.outputs.size());
+			for(auto value : processImage.outputs) outputs->arrayValue->push_back(std::make_shared<Variable>((int32_t)value));
+
+			entry->structValue->emplace("TIME", std::make_shared<Variable>(processImage.time));
+			entry->structValue->emplace("INPUTS", inputs);
+			entry->structValue->emplace("OUTPUTS", outputs);
+			result->arrayValue->push_back(entry);
+		}
+
+		return result;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return Variable::createError(-32500, "Unknown application error.");
+}
+
 PVariable MyCentral::deleteDevice(BaseLib::PRpcClientInfo clientInfo, std::string serialNumber, int32_t flags)
 {
 	try
@@ -1072,7 +1722,14 @@ PVariable MyCentral::setInterface(BaseLib::PRpcClientInfo clientInfo, uint64_t p
 	{
 		std::shared_ptr<MyPeer> peer(getPeer(peerId));
 		if(!peer) return Variable::createError(-2, "Unknown device.");
-		return peer->setInterface(clientInfo, interfaceId);
+		std::string oldInterfaceId = peer->getPhysicalInterface() ? peer->getPhysicalInterface()->getID() : "";
+		PVariable result = peer->setInterface(clientInfo, interfaceId);
+		if(result->errorStruct || !peer->getPhysicalInterface() || peer->getPhysicalInterface()->getID() == oldInterfaceId) return result;
+
+		//The addresses, input peer snapshots and read plans of both the old and the new interface change. Without a
+		//changed peer ID all interfaces are updated.
+		updatePeerAddresses();
+		return result;
 	}
 	catch(const std::exception& ex)
     {
@@ -6,9 +6,13 @@
 #include <homegear-base/BaseLib.h>
 #include "MyPeer.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 namespace MyFamily
 {
@@ -27,15 +31,104 @@ public:
 	uint64_t getPeerIdFromSerial(std::string& serialNumber) { std::shared_ptr<MyPeer> peer = getPeer(serialNumber); if(peer) return peer->getID(); else return 0; }
 	std::shared_ptr<MyPeer> getPeer(uint64_t id);
 	std::shared_ptr<MyPeer> getPeer(std::string serialNumber);
-	void updatePeerAddresses(bool booting = false);
+	void updatePeerAddresses(bool booting = false, uint64_t changedPeerId = 0);
+
+	/**
+	 * Passes the input registers of every interface together with the poll interval of the peers using them to the
+	 * interface.
+	 */
+	void updateReadPlans();
+
+	/**
+	 * Makes the worker thread call the peers right away instead of after its regular interval.
+	 */
+	void wakeUpWorker();
 
 	virtual PVariable createDevice(BaseLib::PRpcClientInfo clientInfo, int32_t deviceType, std::string serialNumber, int32_t address, int32_t firmwareVersion, std::string interfaceId);
 	virtual PVariable deleteDevice(BaseLib::PRpcClientInfo clientInfo, std::string serialNumber, int32_t flags);
 	virtual PVariable deleteDevice(BaseLib::PRpcClientInfo clientInfo, uint64_t peerId, int32_t flags);
 	virtual PVariable setInterface(BaseLib::PRpcClientInfo clientInfo, uint64_t peerId, std::string interfaceId);
 protected:
+	//{{{ Family RPC methods
+	/**
+	 * Creates the peers of a rack in one go. Parameters: interface ID, array of structs with "deviceType" and
+	 * "serialNumber" in physical order, optionally the ID of the existing peer following the last new peer. NEXT_PEER_ID
+	 * is chained automatically and the addresses are calculated once.
+	 */
+	BaseLib::PVariable createDevices(const BaseLib::PRpcClientInfo& clientInfo, const BaseLib::PArray& parameters);
+
+	/**
+	 * Deletes all peers in the passed array of peer IDs.
+	 */
+	BaseLib::PVariable deleteDevices(const BaseLib::PRpcClientInfo& clientInfo, const BaseLib::PArray& parameters);
+
+	/**
+	 * Returns the recorded process images of an interface. Parameters: interface ID, start time and end time in
+	 * milliseconds since epoch, optionally the first register and the number of registers. Returns an array of structs
+	 * with "TIME", "INPUTS" and "OUTPUTS".
+	 */
+	BaseLib::PVariable getProcessImageHistory(const BaseLib::PRpcClientInfo& clientInfo, const BaseLib::PArray& parameters);
+	//}}}
+
 	const uint16_t _bitMask[16] = { 0b0000000000000001, 0b0000000000000010, 0b0000000000000100, 0b0000000000001000, 0b0000000000010000, 0b0000000000100000, 0b0000000001000000, 0b0000000010000000, 0b0000000100000000, 0b0000001000000000, 0b0000010000000000, 0b0000100000000000, 0b0001000000000000, 0b0010000000000000, 0b0100000000000000, 0b1000000000000000 };
 
+	/**
+	 * The input peers of one physical interface. The snapshot is replaced as a whole when peers change, so packet
+	 * processing only copies the pointer.
+	 */
+	struct InterfacePeers
+	{
+		std::mutex inputPeersMutex;
+		std::shared_ptr<std::vector<PMyPeer>> inputPeers;
+	};
+
+	std::unordered_map<std::string, std::unique_ptr<InterfacePeers>> _interfacePeers; //Filled in init() and not modified afterwards, so it needs no lock.
+
+	uint32_t _readGapThreshold = 32; //Maximum number of unused registers read to save a request
+
+	std::mutex _addressChainsMutex;
+	std::unordered_map<std::string, std::vector<uint64_t>> _addressChains;
+
+	std::thread _workerThread;
+	std::atomic_bool _stopWorkerThread{false};
+	std::mutex _workerMutex;
+	std::condition_variable _workerConditionVariable;
+	bool _workerWakeUp = false;
+
+	/**
+	 * Runs periodic tasks of the input peers like publishing pulse counters.
+	 */
+	void worker();
+
+	//{{{ Decoder pool
+	std::vector<std::thread> _decoderThreads;
+	std::atomic_bool _stopDecoderThreads{false};
+	std::mutex _decoderBatchMutex; //Held by the thread distributing a packet. Only one packet is decoded in parallel at a time.
+	std::mutex _decoderMutex;
+	std::condition_variable _decoderConditionVariable;
+	std::condition_variable _decoderDoneConditionVariable;
+	uint64_t _decoderGeneration = 0;
+	uint32_t _decoderActiveWorkers = 0;
+	const std::vector<uint16_t>* _decoderSourceData = nullptr;
+	std::shared_ptr<std::vector<PMyPeer>> _decoderPeers;
+	std::atomic<uint32_t> _decoderNextPeer{0};
+	std::atomic<uint32_t> _decoderFinishedPeers{0};
+
+	void startDecoderThreads();
+	void stopDecoderThreads();
+	void decoderThread();
+
+	/**
+	 * Decodes peers of the current batch until none is left. Called by the workers and by the distributing thread.
+	 */
+	void decodeQueuedPeers(std::vector<uint16_t>& destinationData);
+
+	/**
+	 * Copies the input bits of a peer out of the process image and passes them to the peer.
+	 */
+	void decodePeer(const std::vector<uint16_t>& sourceData, const PMyPeer& peer, std::vector<uint16_t>& destinationData);
+	//}}}
+
 	virtual void init();
 	virtual void loadPeers();
 	virtual void savePeers(bool full);
@@ -43,6 +136,26 @@ protected:
 	virtual void saveVariables() {}
 	std::shared_ptr<MyPeer> createPeer(uint32_t type, int32_t address, std::string serialNumber, bool save = true);
 	void deletePeer(uint64_t id);
+	void deletePeers(const std::vector<uint64_t>& ids);
+
+	/**
+	 * Calculates the Modbus read requests for the input registers. registerIntervals contains the poll interval of every
+	 * register or -1 for registers no peer uses. Ranges are merged when the gap between them is at most gapThreshold
+	 * registers.
+	 */
+	static std::vector<MainInterface::ReadRange> planReads(const std::vector<int32_t>& registerIntervals, uint32_t gapThreshold);
+
+	/**
+	 * Rebuilds the input peer snapshots of all interfaces. Needs to be called whenever peers are added, removed or moved
+	 * to another interface.
+	 */
+	void updateInputPeers();
+
+	/**
+	 * Returns the peers of an interface in physical order. When changedPeerId is set and part of the cached chain, only
+	 * the part of the chain following that peer is walked again.
+	 */
+	std::vector<PMyPeer> updateAddressChain(const std::string& interfaceId, std::unordered_map<uint64_t, PMyPeer>& peers, uint64_t changedPeerId);
 };
 
 }
@@ -10,14 +10,14 @@ MyPacket::MyPacket()
 {
 }
 
-MyPacket::MyPacket(uint16_t startBit, uint16_t endBit, std::vector<uint16_t>& data) : _startBit(startBit), _endBit(endBit), _data(data)
+MyPacket::MyPacket(uint32_t startBit, uint32_t endBit, std::vector<uint16_t>& data) : _startBit(startBit), _endBit(endBit), _data(data)
 {
 	_timeReceived = BaseLib::HelperFunctions::getTime();
 	_startRegister = _startBit / 16;
 	_endRegister = _endBit / 16;
 }
 
-MyPacket::MyPacket(uint16_t startBit, uint16_t endBit, uint16_t data) : _startBit(startBit), _endBit(endBit)
+MyPacket::MyPacket(uint32_t startBit, uint32_t endBit, uint16_t data) : _startBit(startBit), _endBit(endBit)
 {
 	_timeReceived = BaseLib::HelperFunctions::getTime();
 	_startRegister = _startBit / 16;
@@ -30,4 +30,14 @@ MyPacket::~MyPacket()
 	_data.clear();
 }
 
+void MyPacket::reset(uint32_t startBit, uint32_t endBit, const std::vector<uint16_t>& data)
+{
+	_timeReceived = BaseLib::HelperFunctions::getTime();
+	_startBit = startBit;
+	_endBit = endBit;
+	_startRegister = _startBit / 16;
+	_endRegister = _endBit / 16;
+	_data.assign(data.begin(), data.end());
+}
+
 }
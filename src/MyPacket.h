@@ -12,21 +12,26 @@ class MyPacket : public BaseLib::Systems::Packet
 {
     public:
         MyPacket();
-        MyPacket(uint16_t startBit, uint16_t endBit, std::vector<uint16_t>& data);
-        MyPacket(uint16_t startBit, uint16_t endBit, uint16_t data);
+        MyPacket(uint32_t startBit, uint32_t endBit, std::vector<uint16_t>& data);
+        MyPacket(uint32_t startBit, uint32_t endBit, uint16_t data);
         virtual ~MyPacket();
 
-        uint16_t& getStartBit() { return _startBit; }
-        uint16_t& getEndBit() { return _endBit; }
-        uint8_t& getStartRegister() { return _startRegister; }
-        uint8_t& getEndRegister() { return _endRegister; }
+        /**
+         * Reinitializes the packet so it can be reused without allocating. The capacity of the data vector is kept.
+         */
+        void reset(uint32_t startBit, uint32_t endBit, const std::vector<uint16_t>& data);
+
+        uint32_t& getStartBit() { return _startBit; }
+        uint32_t& getEndBit() { return _endBit; }
+        uint32_t& getStartRegister() { return _startRegister; }
+        uint32_t& getEndRegister() { return _endRegister; }
         std::vector<uint16_t>& getData() { return _data; }
 
     protected:
-        uint16_t _startBit = 0;
-        uint16_t _endBit = 0;
-        uint8_t _startRegister = 0;
-        uint8_t _endRegister = 0;
+        uint32_t _startBit = 0;
+        uint32_t _endBit = 0;
+        uint32_t _startRegister = 0;
+        uint32_t _endRegister = 0;
         std::vector<uint16_t> _data;
 };
 
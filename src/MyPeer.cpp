@@ -60,9 +60,39 @@ void MyPeer::init()
 	}
 }
 
+std::shared_ptr<MyPeer::EventAddresses> MyPeer::getEventAddresses()
+{
+	try
+	{
+		std::lock_guard<std::mutex> eventAddressesGuard(_eventAddressesMutex);
+		if(_eventAddresses && _eventAddresses->serialNumber == _serialNumber) return _eventAddresses;
+
+		auto eventAddresses = std::make_shared<EventAddresses>();
+		eventAddresses->serialNumber = _serialNumber;
+		eventAddresses->eventSource = "device-" + std::to_string(_peerID);
+		uint32_t channelCount = (_rpcDevice && !_rpcDevice->functions.empty()) ? _rpcDevice->functions.rbegin()->first + 1 : 1;
+		eventAddresses->channelAddresses.reserve(channelCount);
+		for(uint32_t channel = 0; channel < channelCount; channel++)
+		{
+			eventAddresses->channelAddresses.push_back(_serialNumber + ":" + std::to_string(channel));
+		}
+		_eventAddresses = eventAddresses;
+		return _eventAddresses;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return std::make_shared<EventAddresses>();
+}
+
 void MyPeer::dispose()
 {
 	if(_disposing) return;
+	{
+		std::lock_guard<std::mutex> pulseCountersGuard(_pulseCountersMutex);
+		unregisterPulseCounters();
+	}
 	Peer::dispose();
 }
 
@@ -128,6 +158,7 @@ void MyPeer::setInputAddress(size_t value)
     {
         if(_inputAddress == value) return;
         _inputAddress = value;
+        if(_hasPulseCounters) updatePulseCounters();
         auto channelIterator = configCentral.find(0);
         if(channelIterator == configCentral.end()) return;
         auto parameterIterator = channelIterator->second.find("INPUT_ADDRESS");
@@ -389,6 +420,7 @@ void MyPeer::setPhysicalInterface(std::shared_ptr<MainInterface> interface)
 	{
 		if(!interface) return;
 		_physicalInterface = interface;
+		if(_hasPulseCounters) updatePulseCounters();
 	}
 	catch(const std::exception& ex)
     {
@@ -471,6 +503,8 @@ void MyPeer::saveVariables()
 	{
 		if(_peerID == 0) return;
 		Peer::saveVariables();
+		if(_hasDeferredValues) publishDeferredValues(true);
+		if(_hasPulseCounters) savePulseCounters(true);
 		std::vector<char> states = serializeStates();
 		saveVariable(5, states);
 		saveVariable(19, _physicalInterfaceId);
@@ -513,13 +547,6 @@ bool MyPeer::load(BaseLib::Systems::ICentral* central)
 				}
 			}
 
-			int32_t interval = 0;
-			int32_t decimalPlaces = 0;
-			int32_t inputMin = 0;
-			int32_t inputMax = 0;
-			int32_t outputMin = 0;
-			int32_t outputMax = 0;
-
             std::unordered_map<std::string, BaseLib::Systems::RpcConfigurationParameter>::iterator parameterIterator = i->second.find("INPUT_ADDRESS");
             if(parameterIterator != i->second.end() && parameterIterator->second.rpcParameter)
             {
@@ -533,8 +560,34 @@ bool MyPeer::load(BaseLib::Systems::ICentral* central)
                 std::vector<uint8_t> parameterData = parameterIterator->second.getBinaryData();
                 _outputAddress = parameterIterator->second.rpcParameter->convertFromPacket(parameterData, parameterIterator->second.mainRole(), false)->integerValue;
             }
+		}
+
+		updateCaches();
+		setOutputData();
+
+		return true;
+	}
+	catch(const std::exception& ex)
+    {
+    	GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+    }
+    return false;
+}
+
+void MyPeer::updateCaches()
+{
+	try
+	{
+		for(std::unordered_map<uint32_t, std::unordered_map<std::string, BaseLib::Systems::RpcConfigurationParameter>>::iterator i = configCentral.begin(); i != configCentral.end(); ++i)
+		{
+			int32_t interval = 0;
+			int32_t decimalPlaces = 0;
+			int32_t inputMin = 0;
+			int32_t inputMax = 0;
+			int32_t outputMin = 0;
+			int32_t outputMax = 0;
 
-			parameterIterator = i->second.find("INTERVAL");
+			auto parameterIterator = i->second.find("INTERVAL");
 			if(parameterIterator != i->second.end() && parameterIterator->second.rpcParameter)
 			{
 				std::vector<uint8_t> parameterData = parameterIterator->second.getBinaryData();
@@ -582,18 +635,19 @@ bool MyPeer::load(BaseLib::Systems::ICentral* central)
 			_maximumInputValues[i->first] = inputMax;
 			_minimumOutputValues[i->first] = outputMin;
 			_maximumOutputValues[i->first] = outputMax;
-
 		}
 
-		setOutputData();
-
-		return true;
+		updateFastModes();
+		updateOutputChannels();
+		updateAnalogInputs();
+		updatePollInterval();
+		updatePulseCounters();
+		updateDebouncedInputs();
 	}
 	catch(const std::exception& ex)
-    {
-    	GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
-    }
-    return false;
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
 }
 
 void MyPeer::setOutputData()
@@ -613,6 +667,784 @@ void MyPeer::setOutputData()
     }
 }
 
+void MyPeer::updateFastModes()
+{
+	try
+	{
+		bool fastMode = false;
+		bool superFastMode = false;
+		auto configChannelIterator = configCentral.find(0);
+		if(configChannelIterator != configCentral.end())
+		{
+			auto parameterIterator = configChannelIterator->second.find("FAST_MODE");
+			if(parameterIterator != configChannelIterator->second.end() && parameterIterator->second.rpcParameter)
+			{
+				std::vector<uint8_t> parameterData = parameterIterator->second.getBinaryData();
+				fastMode = parameterIterator->second.rpcParameter->convertFromPacket(parameterData, parameterIterator->second.mainRole(), false)->booleanValue;
+			}
+			parameterIterator = configChannelIterator->second.find("SUPER_FAST_MODE");
+			if(parameterIterator != configChannelIterator->second.end() && parameterIterator->second.rpcParameter)
+			{
+				std::vector<uint8_t> parameterData = parameterIterator->second.getBinaryData();
+				superFastMode = parameterIterator->second.rpcParameter->convertFromPacket(parameterData, parameterIterator->second.mainRole(), false)->booleanValue;
+			}
+		}
+		_fastMode = fastMode;
+		_superFastMode = superFastMode;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MyPeer::updateAnalogInputs()
+{
+	try
+	{
+		auto analogInputs = std::make_shared<AnalogInputs>();
+		if(_rpcDevice && isAnalog())
+		{
+			for(Functions::iterator functionsIterator = _rpcDevice->functions.find(1); functionsIterator != _rpcDevice->functions.end(); ++functionsIterator)
+			{
+				int32_t channel = functionsIterator->first;
+				if(!functionsIterator->second->variables) continue;
+				auto channelIterator = valuesCentral.find(channel);
+				if(channelIterator == valuesCentral.end() || channelIterator->second.empty()) continue;
+				auto variableIterator = channelIterator->second.find("LEVEL");
+				if(variableIterator == channelIterator->second.end()) variableIterator = channelIterator->second.begin();
+				if(!variableIterator->second.rpcParameter) continue;
+				auto levelParameter = std::dynamic_pointer_cast<LogicalDecimal>(variableIterator->second.rpcParameter->logical);
+				if(!levelParameter) continue;
+
+				double inputMin = levelParameter->minimumValue;
+				double inputMax = levelParameter->maximumValue;
+				double outputMin = levelParameter->minimumValue;
+				double outputMax = levelParameter->maximumValue;
+				if(_minimumInputValues[channel] != 0 || _maximumInputValues[channel] != 0)
+				{
+					inputMin = _minimumInputValues[channel];
+					inputMax = _maximumInputValues[channel];
+				}
+				if(_minimumOutputValues[channel] != 0 || _maximumOutputValues[channel] != 0)
+				{
+					outputMin = _minimumOutputValues[channel];
+					outputMax = _maximumOutputValues[channel];
+				}
+
+				analogInputs->channels.push_back(channel);
+				analogInputs->registerIndexes.push_back((channel - 1) + functionsIterator->second->variables->memoryAddressStart / 16);
+				analogInputs->isSigned.push_back(levelParameter->minimumValue < 0);
+				analogInputs->inputMin.push_back(inputMin);
+				analogInputs->inputMax.push_back(inputMax);
+				analogInputs->outputMin.push_back(outputMin);
+				analogInputs->outputMax.push_back(outputMax);
+				analogInputs->decimalFactors.push_back(BaseLib::Math::Pow10(_decimalPlaces[channel]));
+				analogInputs->intervals.push_back(_intervals[channel]);
+				analogInputs->parameters.push_back(&variableIterator->second);
+				analogInputs->names.push_back(&variableIterator->first);
+				analogInputs->lastConverted.push_back(0);
+				analogInputs->lastValues.push_back(0);
+				analogInputs->hasLastValue.push_back(false);
+			}
+		}
+
+		std::lock_guard<std::mutex> analogInputsGuard(_analogInputsMutex);
+		if(_analogInputs)
+		{
+			//Keep the publishing state, so a configuration change neither resets INTERVAL nor republishes unchanged values.
+			for(size_t i = 0; i < analogInputs->channels.size(); i++)
+			{
+				for(size_t j = 0; j < _analogInputs->channels.size(); j++)
+				{
+					if(_analogInputs->channels[j] != analogInputs->channels[i]) continue;
+					analogInputs->lastConverted[i] = _analogInputs->lastConverted[j];
+					analogInputs->lastValues[i] = _analogInputs->lastValues[j];
+					analogInputs->hasLastValue[i] = _analogInputs->hasLastValue[j];
+					break;
+				}
+			}
+		}
+		_analogInputs = analogInputs;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MyPeer::updatePollInterval()
+{
+	try
+	{
+		//An input can't be read less often than its fastest channel needs it. Channels without INTERVAL need every cycle.
+		int32_t pollInterval = -1;
+		for(auto& interval : _intervals)
+		{
+			if(interval.first == 0) continue;
+			if(pollInterval == -1 || interval.second < pollInterval) pollInterval = interval.second;
+		}
+		_pollInterval = pollInterval > 0 ? pollInterval : 0;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+double MyPeer::scaleAnalogInput(const AnalogInputs& analogInputs, size_t index, uint16_t rawValue)
+{
+	double value = analogInputs.isSigned[index] ? (double)(int16_t)rawValue : (double)rawValue;
+	value = BaseLib::Math::scale(BaseLib::Math::clamp(value, analogInputs.inputMin[index], analogInputs.inputMax[index]), analogInputs.inputMin[index], analogInputs.inputMax[index], analogInputs.outputMin[index], analogInputs.outputMax[index]);
+	return std::round(value * analogInputs.decimalFactors[index]) / analogInputs.decimalFactors[index];
+}
+
+//{{{ Pulse counters
+void MyPeer::updatePulseCounters()
+{
+	try
+	{
+		std::lock_guard<std::mutex> pulseCountersGuard(_pulseCountersMutex);
+		unregisterPulseCounters();
+		if(!_rpcDevice || isAnalog())
+		{
+			_pulseCounters.clear();
+			_hasPulseCounters = false;
+			return;
+		}
+
+		for(auto& configChannelIterator : configCentral)
+		{
+			int32_t channel = configChannelIterator.first;
+			if(channel == 0) continue;
+
+			int32_t mode = 0;
+			int32_t interval = 1000;
+			auto parameterIterator = configChannelIterator.second.find("COUNTER_MODE");
+			if(parameterIterator != configChannelIterator.second.end() && parameterIterator->second.rpcParameter)
+			{
+				std::vector<uint8_t> parameterData = parameterIterator->second.getBinaryData();
+				mode = parameterIterator->second.rpcParameter->convertFromPacket(parameterData, parameterIterator->second.mainRole(), false)->integerValue;
+			}
+			parameterIterator = configChannelIterator.second.find("COUNTER_INTERVAL");
+			if(parameterIterator != configChannelIterator.second.end() && parameterIterator->second.rpcParameter)
+			{
+				std::vector<uint8_t> parameterData = parameterIterator->second.getBinaryData();
+				interval = parameterIterator->second.rpcParameter->convertFromPacket(parameterData, parameterIterator->second.mainRole(), false)->integerValue;
+			}
+
+			if(mode <= 0 || mode > 3)
+			{
+				_pulseCounters.erase(channel);
+				continue;
+			}
+
+			auto pulseCounterIterator = _pulseCounters.find(channel);
+			if(pulseCounterIterator == _pulseCounters.end())
+			{
+				//Continue with the persisted count
+				PulseCounter pulseCounter;
+				auto channelIterator = valuesCentral.find(channel);
+				if(channelIterator != valuesCentral.end())
+				{
+					auto variableIterator = channelIterator->second.find("COUNTER");
+					if(variableIterator != channelIterator->second.end() && variableIterator->second.rpcParameter)
+					{
+						std::vector<uint8_t> parameterData = variableIterator->second.getBinaryData();
+						pulseCounter.baseCount = (uint64_t)variableIterator->second.rpcParameter->convertFromPacket(parameterData, variableIterator->second.mainRole(), false)->integerValue64;
+					}
+				}
+				pulseCounter.lastCount = pulseCounter.baseCount;
+				pulseCounter.lastPublished = BaseLib::HelperFunctions::getTime();
+				pulseCounterIterator = _pulseCounters.emplace(channel, pulseCounter).first;
+			}
+			pulseCounterIterator->second.mode = mode;
+			pulseCounterIterator->second.interval = interval >= 100 ? interval : 100;
+			pulseCounterIterator->second.bit = _inputAddress + channel - 1;
+		}
+		_hasPulseCounters = !_pulseCounters.empty();
+
+		if(_disposing || !_physicalInterface) return;
+		_pulseCounterInterface = _physicalInterface;
+		for(auto& pulseCounterIterator : _pulseCounters)
+		{
+			_pulseCounterInterface->addEdgeCounter(pulseCounterIterator.second.bit, pulseCounterIterator.second.mode);
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MyPeer::unregisterPulseCounters()
+{
+	if(!_pulseCounterInterface) return;
+	for(auto& pulseCounterIterator : _pulseCounters)
+	{
+		pulseCounterIterator.second.baseCount += _pulseCounterInterface->removeEdgeCounter(pulseCounterIterator.second.bit);
+	}
+	_pulseCounterInterface.reset();
+}
+
+bool MyPeer::isPulseCounter(int32_t channel)
+{
+	std::lock_guard<std::mutex> pulseCountersGuard(_pulseCountersMutex);
+	return _pulseCounters.find(channel) != _pulseCounters.end();
+}
+
+int32_t MyPeer::worker()
+{
+	if(_disposing) return -1;
+	int32_t timeToNextCall = -1;
+	if(_hasPulseCounters)
+	{
+		publishPulseCounters();
+		savePulseCounters(false);
+	}
+	if(_hasDeferredValues) timeToNextCall = publishDeferredValues(false);
+	if(_hasDebouncedInputs)
+	{
+		int32_t timeToNextDebounce = publishDebouncedInputs();
+		if(timeToNextDebounce >= 0 && (timeToNextCall == -1 || timeToNextDebounce < timeToNextCall)) timeToNextCall = timeToNextDebounce;
+	}
+	return timeToNextCall;
+}
+
+//{{{ Load shedding
+void MyPeer::saveValue(int32_t channel, const std::string& name, BaseLib::Systems::RpcConfigurationParameter& parameter, const PVariable& value, int32_t loadSheddingTier, std::vector<uint8_t>& encodeBuffer)
+{
+	if(loadSheddingTier >= 2)
+	{
+		//Only the native value is remembered. It is encoded when it is saved or requested by an RPC getter.
+		std::lock_guard<std::mutex> deferredValuesGuard(_deferredValuesMutex);
+		if(_deferredSaves.empty()) _firstDeferredSave = BaseLib::HelperFunctions::getTime();
+		_deferredSaves[std::make_pair(channel, name)] = value;
+		_hasDeferredValues = true;
+		return;
+	}
+
+	if(_hasDeferredValues)
+	{
+		//An older deferred value must not overwrite this one.
+		std::lock_guard<std::mutex> deferredValuesGuard(_deferredValuesMutex);
+		_deferredSaves.erase(std::make_pair(channel, name));
+	}
+
+	encodeBuffer.clear();
+	_binaryEncoder->encodeResponse(value, encodeBuffer);
+	parameter.setBinaryData(encodeBuffer);
+	if(parameter.databaseId > 0) saveParameter(parameter.databaseId, encodeBuffer);
+	else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, name, encodeBuffer);
+}
+
+void MyPeer::encodeDeferredValue(uint32_t channel, const std::string& name)
+{
+	try
+	{
+		std::lock_guard<std::mutex> deferredValuesGuard(_deferredValuesMutex);
+		auto deferredSaveIterator = _deferredSaves.find(std::make_pair((int32_t)channel, name));
+		if(deferredSaveIterator == _deferredSaves.end()) return;
+		auto channelIterator = valuesCentral.find(channel);
+		if(channelIterator == valuesCentral.end()) return;
+		auto variableIterator = channelIterator->second.find(name);
+		if(variableIterator == channelIterator->second.end()) return;
+		std::vector<uint8_t> parameterData;
+		_binaryEncoder->encodeResponse(deferredSaveIterator->second, parameterData);
+		variableIterator->second.setBinaryData(parameterData);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+int32_t MyPeer::publishDeferredValues(bool flush)
+{
+	try
+	{
+		int32_t loadSheddingTier = _physicalInterface ? _physicalInterface->getLoadSheddingTier() : 0;
+		int64_t now = BaseLib::HelperFunctions::getTime();
+		int32_t timeToNextCall = -1;
+		std::map<std::pair<int32_t, std::string>, PVariable> deferredSaves;
+		std::map<int32_t, std::map<std::string, PVariable>> coalescedEvents;
+		{
+			std::lock_guard<std::mutex> deferredValuesGuard(_deferredValuesMutex);
+			if(!_deferredSaves.empty())
+			{
+				if(flush || loadSheddingTier < 2 || now - _firstDeferredSave >= _deferredSaveInterval) deferredSaves.swap(_deferredSaves);
+				else timeToNextCall = _deferredSaveInterval - (now - _firstDeferredSave);
+			}
+			if(!_coalescedEvents.empty())
+			{
+				if(flush || loadSheddingTier < 3 || now - _firstCoalescedEvent >= _coalescedEventInterval) coalescedEvents.swap(_coalescedEvents);
+				else
+				{
+					int32_t timeToNextEvent = _coalescedEventInterval - (now - _firstCoalescedEvent);
+					if(timeToNextCall == -1 || timeToNextEvent < timeToNextCall) timeToNextCall = timeToNextEvent;
+				}
+			}
+			_hasDeferredValues = !_deferredSaves.empty() || !_coalescedEvents.empty();
+		}
+
+		std::vector<uint8_t> parameterData;
+		for(auto& deferredSave : deferredSaves)
+		{
+			auto channelIterator = valuesCentral.find(deferredSave.first.first);
+			if(channelIterator == valuesCentral.end()) continue;
+			auto variableIterator = channelIterator->second.find(deferredSave.first.second);
+			if(variableIterator == channelIterator->second.end()) continue;
+			saveValue(deferredSave.first.first, deferredSave.first.second, variableIterator->second, deferredSave.second, 0, parameterData);
+		}
+
+		if(!coalescedEvents.empty())
+		{
+			auto eventAddresses = getEventAddresses();
+			for(auto& channelEvents : coalescedEvents)
+			{
+				if(channelEvents.first < 0 || (uint32_t)channelEvents.first >= eventAddresses->channelAddresses.size()) continue;
+				std::shared_ptr<std::vector<std::string>> valueKeys = std::make_shared<std::vector<std::string>>();
+				std::shared_ptr<std::vector<PVariable>> rpcValues = std::make_shared<std::vector<PVariable>>();
+				valueKeys->reserve(channelEvents.second.size());
+				rpcValues->reserve(channelEvents.second.size());
+				for(auto& value : channelEvents.second)
+				{
+					valueKeys->push_back(value.first);
+					rpcValues->push_back(value.second);
+				}
+				raiseEvent(eventAddresses->eventSource, _peerID, channelEvents.first, valueKeys, rpcValues);
+				raiseRPCEvent(eventAddresses->eventSource, _peerID, channelEvents.first, eventAddresses->channelAddresses[channelEvents.first], valueKeys, rpcValues);
+			}
+		}
+
+		return timeToNextCall;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return -1;
+}
+//}}}
+
+void MyPeer::publishPulseCounters()
+{
+	try
+	{
+		struct DueCounter
+		{
+			int32_t channel;
+			uint64_t count;
+			double frequency;
+		};
+		std::vector<DueCounter> dueCounters;
+
+		{
+			int64_t now = BaseLib::HelperFunctions::getTime();
+			std::lock_guard<std::mutex> pulseCountersGuard(_pulseCountersMutex);
+			for(auto& pulseCounterIterator : _pulseCounters)
+			{
+				PulseCounter& pulseCounter = pulseCounterIterator.second;
+				int64_t elapsed = now - pulseCounter.lastPublished;
+				if(elapsed < pulseCounter.interval) continue;
+
+				DueCounter dueCounter;
+				dueCounter.channel = pulseCounterIterator.first;
+				dueCounter.count = pulseCounter.baseCount;
+				if(_pulseCounterInterface) dueCounter.count += _pulseCounterInterface->getEdgeCount(pulseCounter.bit);
+				//When both edges are counted, one period consists of two edges.
+				dueCounter.frequency = (double)(dueCounter.count - pulseCounter.lastCount) * 1000.0 / elapsed / (pulseCounter.mode == 3 ? 2 : 1);
+				pulseCounter.lastCount = dueCounter.count;
+				pulseCounter.lastPublished = now;
+				dueCounters.push_back(dueCounter);
+			}
+		}
+		if(dueCounters.empty()) return;
+
+		std::vector<int32_t> changedChannels;
+		auto eventAddresses = getEventAddresses();
+		for(auto& dueCounter : dueCounters)
+		{
+			auto channelIterator = valuesCentral.find(dueCounter.channel);
+			if(channelIterator == valuesCentral.end()) continue;
+
+			std::shared_ptr<std::vector<std::string>> valueKeys = std::make_shared<std::vector<std::string>>();
+			std::shared_ptr<std::vector<PVariable>> rpcValues = std::make_shared<std::vector<PVariable>>();
+			std::vector<std::pair<std::string, PVariable>> values{ { "COUNTER", std::make_shared<BaseLib::Variable>((int64_t)dueCounter.count) }, { "FREQUENCY", std::make_shared<BaseLib::Variable>(dueCounter.frequency) } };
+			for(auto& value : values)
+			{
+				auto variableIterator = channelIterator->second.find(value.first);
+				if(variableIterator == channelIterator->second.end() || !variableIterator->second.rpcParameter) continue;
+				auto& parameter = variableIterator->second;
+
+				//Unchanged values are neither saved nor published, so idle counters cause no load. Changed values are saved by
+				//savePulseCounters().
+				std::vector<uint8_t> parameterData;
+				_binaryEncoder->encodeResponse(value.second, parameterData);
+				if(parameter.equals(parameterData)) continue;
+				parameter.setBinaryData(parameterData);
+
+				valueKeys->push_back(value.first);
+				rpcValues->push_back(value.second);
+			}
+
+			if(valueKeys->empty()) continue;
+			changedChannels.push_back(dueCounter.channel);
+			if((uint32_t)dueCounter.channel >= eventAddresses->channelAddresses.size()) continue;
+			raiseEvent(eventAddresses->eventSource, _peerID, dueCounter.channel, valueKeys, rpcValues);
+			raiseRPCEvent(eventAddresses->eventSource, _peerID, dueCounter.channel, eventAddresses->channelAddresses[dueCounter.channel], valueKeys, rpcValues);
+		}
+		if(changedChannels.empty()) return;
+
+		std::lock_guard<std::mutex> pulseCountersGuard(_pulseCountersMutex);
+		for(auto channel : changedChannels)
+		{
+			auto pulseCounterIterator = _pulseCounters.find(channel);
+			if(pulseCounterIterator != _pulseCounters.end()) pulseCounterIterator->second.unsaved = true;
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MyPeer::savePulseCounters(bool force)
+{
+	try
+	{
+		std::vector<int32_t> unsavedChannels;
+		{
+			int64_t now = BaseLib::HelperFunctions::getTime();
+			std::lock_guard<std::mutex> pulseCountersGuard(_pulseCountersMutex);
+			if(!force && now - _lastCounterSave < _counterSaveInterval) return;
+			_lastCounterSave = now;
+			for(auto& pulseCounterIterator : _pulseCounters)
+			{
+				if(!pulseCounterIterator.second.unsaved) continue;
+				pulseCounterIterator.second.unsaved = false;
+				unsavedChannels.push_back(pulseCounterIterator.first);
+			}
+		}
+
+		for(auto channel : unsavedChannels)
+		{
+			auto channelIterator = valuesCentral.find(channel);
+			if(channelIterator == valuesCentral.end()) continue;
+			for(auto& name : { "COUNTER", "FREQUENCY" })
+			{
+				auto variableIterator = channelIterator->second.find(name);
+				if(variableIterator == channelIterator->second.end()) continue;
+				auto& parameter = variableIterator->second;
+				std::vector<uint8_t> parameterData = parameter.getBinaryData();
+				if(parameter.databaseId > 0) saveParameter(parameter.databaseId, parameterData);
+				else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, name, parameterData);
+			}
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+//}}}
+
+//{{{ Debouncing
+void MyPeer::updateDebouncedInputs()
+{
+	try
+	{
+		std::lock_guard<std::mutex> debounceGuard(_debounceMutex);
+		_debouncedInputs.clear();
+		if(_rpcDevice && !isAnalog())
+		{
+			for(auto& configChannelIterator : configCentral)
+			{
+				if(configChannelIterator.first == 0) continue;
+				auto parameterIterator = configChannelIterator.second.find("DEBOUNCE_TIME");
+				if(parameterIterator == configChannelIterator.second.end() || !parameterIterator->second.rpcParameter) continue;
+				std::vector<uint8_t> parameterData = parameterIterator->second.getBinaryData();
+				int32_t debounceTime = parameterIterator->second.rpcParameter->convertFromPacket(parameterData, parameterIterator->second.mainRole(), false)->integerValue;
+				if(debounceTime <= 0) continue;
+				_debouncedInputs[configChannelIterator.first].debounceTime = debounceTime;
+			}
+		}
+		_hasDebouncedInputs = !_debouncedInputs.empty();
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+bool MyPeer::holdInput(int32_t channel, bool value, int64_t now)
+{
+	bool wakeUpWorker = false;
+	{
+		std::lock_guard<std::mutex> debounceGuard(_debounceMutex);
+		auto debouncedInputIterator = _debouncedInputs.find(channel);
+		if(debouncedInputIterator == _debouncedInputs.end()) return false;
+		DebouncedInput& debouncedInput = debouncedInputIterator->second;
+		if(debouncedInput.pending && debouncedInput.value == value)
+		{
+			if(now - debouncedInput.since < debouncedInput.debounceTime) return true;
+			debouncedInput.pending = false;
+			return false;
+		}
+		debouncedInput.pending = true;
+		debouncedInput.value = value;
+		debouncedInput.since = now;
+		wakeUpWorker = true;
+	}
+
+	//Make sure the worker checks the channel again when the debounce time is over.
+	if(wakeUpWorker)
+	{
+		std::shared_ptr<MyCentral> central = std::dynamic_pointer_cast<MyCentral>(getCentral());
+		if(central) central->wakeUpWorker();
+	}
+	return true;
+}
+
+void MyPeer::cancelBouncedInputs(const std::vector<uint16_t>& packet)
+{
+	//A pending change is dropped when the input returned to its published value before the debounce time was over.
+	std::lock_guard<std::mutex> debounceGuard(_debounceMutex);
+	for(auto& debouncedInputIterator : _debouncedInputs)
+	{
+		DebouncedInput& debouncedInput = debouncedInputIterator.second;
+		if(!debouncedInput.pending) continue;
+		uint32_t index = (debouncedInputIterator.first - 1) / 16;
+		if(index >= packet.size()) continue;
+		bool value = packet[index] & _bitMask[(debouncedInputIterator.first - 1) % 16];
+		if(value != debouncedInput.value) debouncedInput.pending = false;
+	}
+}
+
+int32_t MyPeer::publishDebouncedInputs()
+{
+	try
+	{
+		std::vector<std::pair<int32_t, bool>> stableInputs;
+		int32_t timeToNextCheck = -1;
+		{
+			int64_t now = BaseLib::HelperFunctions::getTime();
+			std::lock_guard<std::mutex> statesGuard(_statesMutex);
+			std::lock_guard<std::mutex> debounceGuard(_debounceMutex);
+			for(auto& debouncedInputIterator : _debouncedInputs)
+			{
+				DebouncedInput& debouncedInput = debouncedInputIterator.second;
+				if(!debouncedInput.pending) continue;
+				int64_t remainingTime = debouncedInput.debounceTime - (now - debouncedInput.since);
+				if(remainingTime > 0)
+				{
+					if(timeToNextCheck == -1 || remainingTime < timeToNextCheck) timeToNextCheck = remainingTime;
+					continue;
+				}
+
+				debouncedInput.pending = false;
+				uint32_t index = (debouncedInputIterator.first - 1) / 16;
+				uint32_t bit = (debouncedInputIterator.first - 1) % 16;
+				if(index >= _states.size()) continue;
+				if((bool)(_states[index] & _bitMask[bit]) == debouncedInput.value) continue;
+				if(debouncedInput.value) _states[index] |= _bitMask[bit];
+				else _states[index] &= _reversedBitMask[bit];
+				stableInputs.emplace_back(debouncedInputIterator.first, debouncedInput.value);
+			}
+		}
+		if(stableInputs.empty()) return timeToNextCheck;
+
+		int32_t loadSheddingTier = _physicalInterface ? _physicalInterface->getLoadSheddingTier() : 0;
+		std::vector<uint8_t> parameterData;
+		auto eventAddresses = getEventAddresses();
+		for(auto& stableInput : stableInputs)
+		{
+			int32_t channel = stableInput.first;
+			if(_hasPulseCounters && isPulseCounter(channel)) continue;
+
+			auto channelIterator = valuesCentral.find(channel);
+			if(channelIterator == valuesCentral.end()) continue;
+			auto variableIterator = channelIterator->second.find("STATE");
+			if(variableIterator == channelIterator->second.end() || !variableIterator->second.rpcParameter) continue;
+			auto& parameter = variableIterator->second;
+
+			PVariable value = std::make_shared<BaseLib::Variable>(stableInput.second);
+			saveValue(channel, variableIterator->first, parameter, value, loadSheddingTier, parameterData);
+			if(_bl->debugLevel >= 4) GD::out.printInfo("Info: STATE of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to " + std::to_string(stableInput.second) + ".");
+
+			if((uint32_t)channel >= eventAddresses->channelAddresses.size()) continue;
+			std::shared_ptr<std::vector<std::string>> valueKeys = std::make_shared<std::vector<std::string>>(1, "STATE");
+			std::shared_ptr<std::vector<PVariable>> rpcValues = std::make_shared<std::vector<PVariable>>(1, value);
+			raiseEvent(eventAddresses->eventSource, _peerID, channel, valueKeys, rpcValues);
+			raiseRPCEvent(eventAddresses->eventSource, _peerID, channel, eventAddresses->channelAddresses[channel], valueKeys, rpcValues);
+		}
+		return timeToNextCheck;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return -1;
+}
+//}}}
+
+void MyPeer::updateOutputChannels()
+{
+	try
+	{
+		std::lock_guard<std::mutex> outputChannelsGuard(_outputChannelsMutex);
+		_outputChannels.clear();
+		if(!_rpcDevice || !isOutputDevice()) return;
+
+		for(auto& function : _rpcDevice->functions)
+		{
+			if(function.first == 0) continue;
+			auto channelIterator = valuesCentral.find(function.first);
+			if(channelIterator == valuesCentral.end()) continue;
+
+			for(auto& parameterIterator : channelIterator->second)
+			{
+				if(parameterIterator.first == "PULSE" || parameterIterator.first == "BLINK") continue; //Handled by setTimedOutput()
+				PParameter rpcParameter = parameterIterator.second.rpcParameter;
+				if(!rpcParameter || rpcParameter->physical->operationType != IPhysical::OperationType::Enum::command) continue;
+				if(rpcParameter->setPackets.empty() && !rpcParameter->writeable) continue;
+
+				OutputChannel outputChannel;
+				outputChannel.valueKey = parameterIterator.first;
+				if(rpcParameter->logical->type == ILogical::Type::Enum::tBoolean)
+				{
+					outputChannel.boolean = true;
+					outputChannel.statesIndex = (function.first - 1) / 16;
+					outputChannel.bitIndex = (function.first - 1) % 16;
+				}
+				else
+				{
+					if(!function.second->variables) continue;
+					outputChannel.statesIndex = function.first + (function.second->variables->memoryAddressStart / 16) - 1;
+
+					int32_t channel = function.first;
+					if(_minimumInputValues[channel] != 0 || _maximumInputValues[channel] != 0 || _minimumOutputValues[channel] != 0 || _maximumOutputValues[channel] != 0)
+					{
+						double logicalMin = 0;
+						double logicalMax = 0;
+						auto logicalDecimal = std::dynamic_pointer_cast<LogicalDecimal>(rpcParameter->logical);
+						auto logicalInteger = std::dynamic_pointer_cast<LogicalInteger>(rpcParameter->logical);
+						if(logicalDecimal)
+						{
+							logicalMin = logicalDecimal->minimumValue;
+							logicalMax = logicalDecimal->maximumValue;
+						}
+						else if(logicalInteger)
+						{
+							logicalMin = logicalInteger->minimumValue;
+							logicalMax = logicalInteger->maximumValue;
+						}
+						else continue; //Not supported by the fast path
+
+						outputChannel.scale = true;
+						bool inputRangeSet = _minimumInputValues[channel] != 0 || _maximumInputValues[channel] != 0;
+						bool outputRangeSet = _minimumOutputValues[channel] != 0 || _maximumOutputValues[channel] != 0;
+						outputChannel.inputMin = inputRangeSet ? _minimumInputValues[channel] : logicalMin;
+						outputChannel.inputMax = inputRangeSet ? _maximumInputValues[channel] : logicalMax;
+						outputChannel.outputMin = outputRangeSet ? _minimumOutputValues[channel] : logicalMin;
+						outputChannel.outputMax = outputRangeSet ? _maximumOutputValues[channel] : logicalMax;
+					}
+				}
+
+				_outputChannels.emplace(function.first, std::move(outputChannel));
+				break;
+			}
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+PVariable MyPeer::setTimedOutput(uint32_t channel, const std::string& valueKey, const PVariable& value)
+{
+	try
+	{
+		OutputChannel outputChannel;
+		bool outputChannelFound = false;
+		{
+			std::lock_guard<std::mutex> outputChannelsGuard(_outputChannelsMutex);
+			auto outputChannelIterator = _outputChannels.find(channel);
+			if(outputChannelIterator != _outputChannels.end())
+			{
+				outputChannel = outputChannelIterator->second;
+				outputChannelFound = true;
+			}
+		}
+		if(!outputChannelFound || !outputChannel.boolean) return Variable::createError(-5, "Timed outputs are only supported by digital outputs.");
+		if(!_physicalInterface) return Variable::createError(-32500, "No physical interface.");
+		uint32_t bit = _outputAddress + (outputChannel.statesIndex * 16) + outputChannel.bitIndex;
+
+		std::vector<int32_t> pattern;
+		if(valueKey == "PULSE")
+		{
+			int32_t duration = value->type == VariableType::tFloat ? std::lround(value->floatValue) : value->integerValue;
+			if(duration > 0) pattern.push_back(duration);
+		}
+		else if(value->type == VariableType::tArray)
+		{
+			for(auto& element : *value->arrayValue)
+			{
+				pattern.push_back(element->integerValue);
+			}
+		}
+		else if(value->type == VariableType::tString)
+		{
+			std::vector<std::string> durations = BaseLib::HelperFunctions::splitAll(value->stringValue, ',');
+			for(auto& duration : durations)
+			{
+				BaseLib::HelperFunctions::trim(duration);
+				if(!duration.empty()) pattern.push_back(BaseLib::Math::getNumber(duration));
+			}
+		}
+		else if(value->type != VariableType::tBoolean || value->booleanValue) return Variable::createError(-5, "BLINK expects an array or a comma separated list of durations in milliseconds.");
+
+		if(pattern.size() > 64) return Variable::createError(-5, "Too many steps.");
+		if(pattern.empty()) _physicalInterface->stopTimedOutput(bit);
+		else _physicalInterface->startTimedOutput(bit, pattern, valueKey == "BLINK");
+		return std::make_shared<Variable>(VariableType::tVoid);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return Variable::createError(-32500, "Unknown application error.");
+}
+
+void MyPeer::setOutput(const OutputChannel& outputChannel, uint16_t value)
+{
+	uint32_t startBit = 0;
+	uint32_t bitCount = 0;
+	uint16_t data = 0;
+	{
+		std::lock_guard<std::mutex> statesGuard(_statesMutex);
+		if(outputChannel.statesIndex >= _states.size()) _states.resize(outputChannel.statesIndex + 1, 0);
+		uint16_t& state = _states[outputChannel.statesIndex];
+		if(outputChannel.boolean)
+		{
+			if(value) state |= _bitMask[outputChannel.bitIndex];
+			else state &= _reversedBitMask[outputChannel.bitIndex];
+			startBit = _outputAddress + (outputChannel.statesIndex * 16) + outputChannel.bitIndex;
+			bitCount = 1;
+			data = value ? 1 : 0;
+		}
+		else
+		{
+			state = value;
+			startBit = _outputAddress + (outputChannel.statesIndex * 16) + (isAnalog() ? 0 : _physicalInterface->digitalOutputOffset());
+			bitCount = 16;
+			data = value;
+		}
+	}
+	_physicalInterface->setOutputBits(startBit, bitCount, data);
+}
+
 void MyPeer::packetReceived(std::vector<uint16_t>& packet)
 {
 	try
@@ -621,22 +1453,32 @@ void MyPeer::packetReceived(std::vector<uint16_t>& packet)
 		setLastPacketReceived();
 
 		std::unique_lock<std::mutex> statesGuard(_statesMutex);
-		if(packet.size() == _states.size() && std::equal(packet.begin(), packet.end(), _states.begin())) return;
+		if(packet.size() == _states.size() && std::equal(packet.begin(), packet.end(), _states.begin()))
+		{
+			statesGuard.unlock();
+			if(_hasDebouncedInputs) cancelBouncedInputs(packet);
+			return;
+		}
 
 		_states.resize(packet.size(), 0);
 		statesGuard.unlock();
 
-		std::map<uint32_t, std::shared_ptr<std::vector<std::string>>> valueKeys;
-		std::map<uint32_t, std::shared_ptr<std::vector<PVariable>>> rpcValues;
+		int32_t loadSheddingTier = _physicalInterface ? _physicalInterface->getLoadSheddingTier() : 0;
+		_stagedValues.clear();
 
 		if(isAnalog())
 		{
-			BaseLib::PVariable value;
+			std::lock_guard<std::mutex> analogInputsGuard(_analogInputsMutex);
+			if(!_analogInputs) return;
+			AnalogInputs& analogInputs = *_analogInputs;
 
-			for(Functions::iterator functionsIterator = _rpcDevice->functions.find(1); functionsIterator != _rpcDevice->functions.end(); ++functionsIterator)
+			BaseLib::PVariable value;
+			int64_t now = BaseLib::HelperFunctions::getTime();
+			for(size_t i = 0; i < analogInputs.channels.size(); i++)
 			{
-				int32_t index = (functionsIterator->first - 1) + functionsIterator->second->variables->memoryAddressStart / 16;
-				if(index >= (signed)packet.size()) continue;
+				int32_t channel = analogInputs.channels[i];
+				uint32_t index = analogInputs.registerIndexes[i];
+				if(index >= packet.size()) continue;
 				statesGuard.lock();
 				if(packet.at(index) == _states.at(index))
 				{
@@ -645,88 +1487,43 @@ void MyPeer::packetReceived(std::vector<uint16_t>& packet)
 				}
 				statesGuard.unlock();
 
-                std::string name = "LEVEL";
-				auto channelIterator = valuesCentral.find(functionsIterator->first);
-				if(channelIterator == valuesCentral.end()) continue;
-                auto variableIterator = channelIterator->second.find(name);
-                if(variableIterator == channelIterator->second.end())
-                {
-                    if(channelIterator->second.empty()) continue;
-                    name = channelIterator->second.begin()->first;
-                    variableIterator = channelIterator->second.begin();
-                }
-
-				auto& parameter = variableIterator->second;
-				if(!parameter.rpcParameter) continue;
-
-				{
-					std::lock_guard<std::mutex> lastDataGuard(_lastDataMutex);
-					if(BaseLib::HelperFunctions::getTime() - _lastData[functionsIterator->first] < _intervals[functionsIterator->first]) continue;
-					_lastData[functionsIterator->first] = BaseLib::HelperFunctions::getTime();
-				}
-
-				auto levelParameter = std::dynamic_pointer_cast<LogicalDecimal>(parameter.rpcParameter->logical);
-			    if(!levelParameter) continue;
-				bool isSigned = levelParameter->minimumValue < 0;
+				if(now - analogInputs.lastConverted[i] < analogInputs.intervals[i]) continue;
+				analogInputs.lastConverted[i] = now;
 
 				statesGuard.lock();
 				_states[index] = packet[index];
 				statesGuard.unlock();
 
-				double inputMin = 0;
-				double inputMax = 0;
-				double outputMin = 0;
-				double outputMax = 0;
-				if(_minimumInputValues[functionsIterator->first] != 0 || _maximumInputValues[functionsIterator->first] != 0)
-				{
-					inputMin = _minimumInputValues[functionsIterator->first];
-					inputMax = _maximumInputValues[functionsIterator->first];
-				}
-				else
-				{
-					inputMin = levelParameter->minimumValue;
-					inputMax = levelParameter->maximumValue;
-				}
-				if(_minimumOutputValues[functionsIterator->first] != 0 || _maximumOutputValues[functionsIterator->first] != 0)
-				{
-					outputMin = _minimumOutputValues[functionsIterator->first];
-					outputMax = _maximumOutputValues[functionsIterator->first];
-				}
-				else
-				{
-					outputMin = levelParameter->minimumValue;
-					outputMax = levelParameter->maximumValue;
-				}
+				//Only changed channels past their INTERVAL are converted.
+				double doubleValue = scaleAnalogInput(analogInputs, i, packet[index]);
 
-				double doubleValue = isSigned ? (double)(int16_t)packet[index] : (double)packet[index];
-				doubleValue = BaseLib::Math::scale(BaseLib::Math::clamp(doubleValue, inputMin, inputMax), inputMin, inputMax, outputMin, outputMax);
-				double decimalFactor = BaseLib::Math::Pow10(_decimalPlaces[functionsIterator->first]);
-				doubleValue = std::round(doubleValue * decimalFactor) / decimalFactor;
+				//Compare the native value first. The binary data only needs to be compared once after loading.
+				bool knownValue = analogInputs.hasLastValue[i];
+				if(knownValue && analogInputs.lastValues[i] == doubleValue) continue;
+				analogInputs.lastValues[i] = doubleValue;
+				analogInputs.hasLastValue[i] = true;
 
+				auto& parameter = *analogInputs.parameters[i];
+				const std::string& name = *analogInputs.names[i];
 				value.reset(new BaseLib::Variable(doubleValue));
-				std::vector<uint8_t> parameterData;
-				_binaryEncoder->encodeResponse(value, parameterData);
-				if(parameter.equals(parameterData)) continue;
-				parameter.setBinaryData(parameterData);
-
-				if(!value) continue;
-
-				if(!valueKeys[functionsIterator->first] || !rpcValues[functionsIterator->first])
+				if(!knownValue)
 				{
-					valueKeys[functionsIterator->first].reset(new std::vector<std::string>());
-					rpcValues[functionsIterator->first].reset(new std::vector<PVariable>());
+					_encodeBuffer.clear();
+					_binaryEncoder->encodeResponse(value, _encodeBuffer);
+					if(parameter.equals(_encodeBuffer)) continue;
 				}
 
-				if(parameter.databaseId > 0) saveParameter(parameter.databaseId, parameterData);
-				else saveParameter(0, ParameterGroup::Type::Enum::variables, functionsIterator->first, name, parameterData);
-				if(_bl->debugLevel >= 6) GD::out.printDebug("Debug: " + name + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(functionsIterator->first) + " was set to 0x" + BaseLib::HelperFunctions::getHexString(parameterData) + ".");
+				//The value is only encoded when it is saved now or later by publishDeferredValues().
+				saveValue(channel, name, parameter, value, loadSheddingTier, _encodeBuffer);
+				if(_bl->debugLevel >= 6) GD::out.printDebug("Debug: " + name + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to " + std::to_string(doubleValue) + ".");
 
-				valueKeys[functionsIterator->first]->push_back(name);
-				rpcValues[functionsIterator->first]->push_back(parameter.rpcParameter->convertFromPacket(parameterData, parameter.mainRole(), true));
+				_stagedValues.push_back(StagedValue{ channel, &name, value });
 			}
 		}
 		else
 		{
+			bool hasDebouncedInputs = _hasDebouncedInputs;
+			int64_t now = hasDebouncedInputs ? BaseLib::HelperFunctions::getTime() : 0;
 			for(uint32_t i = 0; i < packet.size(); i++)
 			{
 				std::string name = "STATE";
@@ -743,11 +1540,20 @@ void MyPeer::packetReceived(std::vector<uint16_t>& packet)
 					}
 
 					uint16_t bitValue = packet.at(i) & _bitMask[j];
+					channel = (i * 16) + j + 1;
+					//Changes of debounced channels are published by worker() once they are stable.
+					if(hasDebouncedInputs && holdInput(channel, bitValue, now))
+					{
+						statesGuard.unlock();
+						continue;
+					}
 					_states.at(i) &= _reversedBitMask[j];
 					_states.at(i) |= bitValue;
 					statesGuard.unlock();
 
-					channel = (i * 16) + j + 1;
+					//Counter channels only publish their totals in worker().
+					if(_hasPulseCounters && isPulseCounter(channel)) continue;
+
                     auto channelIterator = valuesCentral.find(channel);
                     if(channelIterator == valuesCentral.end()) continue;
                     auto variableIterator = channelIterator->second.find(name);
@@ -762,40 +1568,59 @@ void MyPeer::packetReceived(std::vector<uint16_t>& packet)
 					if(!parameter.rpcParameter) continue;
 
 					value.reset(new BaseLib::Variable((bool)bitValue));
-					std::vector<uint8_t> parameterData;
-					_binaryEncoder->encodeResponse(value, parameterData);
-					parameter.setBinaryData(parameterData);
 
-					if(!value) continue;
+					//The value is only encoded when it is saved now or later by publishDeferredValues().
+					saveValue(channel, name, parameter, value, loadSheddingTier, _encodeBuffer);
+					if(_bl->debugLevel >= 4) GD::out.printInfo("Info: " + name + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to " + std::to_string((bool)bitValue) + ".");
 
-					if(!valueKeys[channel] || !rpcValues[channel])
-					{
-						valueKeys[channel].reset(new std::vector<std::string>());
-						rpcValues[channel].reset(new std::vector<PVariable>());
-					}
-
-					if(parameter.databaseId > 0) saveParameter(parameter.databaseId, parameterData);
-					else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, name, parameterData);
-					if(_bl->debugLevel >= 4) GD::out.printInfo("Info: " + name + " of peer " + std::to_string(_peerID) + " with serial number " + _serialNumber + ":" + std::to_string(channel) + " was set to 0x" + BaseLib::HelperFunctions::getHexString(parameterData) + ".");
-
-					valueKeys[channel]->push_back(name);
-					rpcValues[channel]->push_back(parameter.rpcParameter->convertFromPacket(parameterData, parameter.mainRole(), true));
+					_stagedValues.push_back(StagedValue{ channel, &variableIterator->first, value });
 				}
 			}
+
+			if(hasDebouncedInputs) cancelBouncedInputs(packet);
 		}
 
-		if(!rpcValues.empty())
+		if(_stagedValues.empty()) return;
+
+		if(loadSheddingTier >= 3 && isAnalog())
+		{
+			//Only the latest value of every variable is published by worker(). Digital inputs are never coalesced.
+			std::lock_guard<std::mutex> deferredValuesGuard(_deferredValuesMutex);
+			if(_coalescedEvents.empty()) _firstCoalescedEvent = BaseLib::HelperFunctions::getTime();
+			for(auto& stagedValue : _stagedValues)
+			{
+				_coalescedEvents[stagedValue.channel][*stagedValue.name] = stagedValue.value;
+			}
+			_hasDeferredValues = true;
+		}
+		else
 		{
-			for(std::map<uint32_t, std::shared_ptr<std::vector<std::string>>>::iterator j = valueKeys.begin(); j != valueKeys.end(); ++j)
+			//The staged values are ordered by channel. Only the vectors passed to raiseEvent() are allocated.
+			auto eventAddresses = getEventAddresses();
+			for(size_t i = 0; i < _stagedValues.size();)
 			{
-				if(j->second->empty()) continue;
+				int32_t channel = _stagedValues[i].channel;
+				size_t end = i + 1;
+				while(end < _stagedValues.size() && _stagedValues[end].channel == channel) end++;
 
-                std::string eventSource = "device-" + std::to_string(_peerID);
-                std::string address(_serialNumber + ":" + std::to_string(j->first));
-                raiseEvent(eventSource, _peerID, j->first, j->second, rpcValues.at(j->first));
-                raiseRPCEvent(eventSource, _peerID, j->first, address, j->second, rpcValues.at(j->first));
+				if((uint32_t)channel < eventAddresses->channelAddresses.size())
+				{
+					std::shared_ptr<std::vector<std::string>> valueKeys = std::make_shared<std::vector<std::string>>();
+					std::shared_ptr<std::vector<PVariable>> rpcValues = std::make_shared<std::vector<PVariable>>();
+					valueKeys->reserve(end - i);
+					rpcValues->reserve(end - i);
+					for(size_t j = i; j < end; j++)
+					{
+						valueKeys->push_back(*_stagedValues[j].name);
+						rpcValues->push_back(_stagedValues[j].value);
+					}
+					raiseEvent(eventAddresses->eventSource, _peerID, channel, valueKeys, rpcValues);
+					raiseRPCEvent(eventAddresses->eventSource, _peerID, channel, eventAddresses->channelAddresses[channel], valueKeys, rpcValues);
+				}
+				i = end;
 			}
 		}
+		_stagedValues.clear();
 	}
 	catch(const std::exception& ex)
 	{
@@ -823,6 +1648,8 @@ bool MyPeer::getAllValuesHook2(PRpcClientInfo clientInfo, PParameter parameter,
 {
 	try
 	{
+		if(_hasDeferredValues) encodeDeferredValue(channel, parameter->id);
+
 		if(channel == 1)
 		{
 			if(parameter->id == "PEER_ID")
@@ -845,6 +1672,8 @@ bool MyPeer::getParamsetHook2(PRpcClientInfo clientInfo, PParameter parameter, u
 {
 	try
 	{
+		if(_hasDeferredValues) encodeDeferredValue(channel, parameter->id);
+
 		if(channel == 1)
 		{
 			if(parameter->id == "PEER_ID")
@@ -863,6 +1692,19 @@ bool MyPeer::getParamsetHook2(PRpcClientInfo clientInfo, PParameter parameter, u
     return false;
 }
 
+PVariable MyPeer::getValue(PRpcClientInfo clientInfo, uint32_t channel, std::string valueKey, bool requestFromDevice, bool asynchronous)
+{
+	try
+	{
+		if(_hasDeferredValues) encodeDeferredValue(channel, valueKey);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return Peer::getValue(clientInfo, channel, valueKey, requestFromDevice, asynchronous);
+}
+
 PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channel, ParameterGroup::Type::Enum type, uint64_t remoteID, int32_t remoteChannel, PVariable variables, bool checkAcls, bool onlyPushing)
 {
 	try
@@ -902,7 +1744,7 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
 						if((uint64_t) i->second->integerValue64 != _nextPeerId)
 						{
 							_nextPeerId = i->second->integerValue64;
-							central->updatePeerAddresses();
+							central->updatePeerAddresses(false, _peerID);
 						}
 					}
 					else if(i->first == "ADDRESS") continue;
@@ -913,6 +1755,7 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
 				if(parameter.databaseId > 0) saveParameter(parameter.databaseId, parameterData);
 				else saveParameter(0, ParameterGroup::Type::Enum::config, channel, i->first, parameterData);
 				GD::out.printInfo("Info: Parameter " + i->first + " of peer " + std::to_string(_peerID) + " and channel " + std::to_string(channel) + " was set to 0x" + BaseLib::HelperFunctions::getHexString(parameterData) + ".");
+				if(channel == 0 && (i->first == "FAST_MODE" || i->first == "SUPER_FAST_MODE")) updateFastModes();
 				if(parameter.rpcParameter->physical->operationType != IPhysical::OperationType::Enum::config && parameter.rpcParameter->physical->operationType != IPhysical::OperationType::Enum::configString) continue;
 
 				if(i->first == "INPUT_MIN" || i->first == "INPUT_MAX" || i->first == "OUTPUT_MIN" || i->first == "OUTPUT_MAX")
@@ -954,6 +1797,8 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
 					_maximumInputValues[channel] = inputMax;
 					_minimumOutputValues[channel] = outputMin;
 					_maximumOutputValues[channel] = outputMax;
+					updateOutputChannels();
+					updateAnalogInputs();
 				}
 				else if(i->first == "INTERVAL")
 				{
@@ -967,6 +1812,10 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
 					}
 
 					_intervals[channel] = interval;
+					updateAnalogInputs();
+					updatePollInterval();
+					std::shared_ptr<MyCentral> central = std::dynamic_pointer_cast<MyCentral>(getCentral());
+					if(central) central->updateReadPlans();
 				}
 				else if(i->first == "DECIMAL_PLACES")
 				{
@@ -980,7 +1829,10 @@ PVariable MyPeer::putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channe
 					}
 
 					_decimalPlaces[channel] = decimalPlaces;
+					updateAnalogInputs();
 				}
+				else if(i->first == "COUNTER_MODE" || i->first == "COUNTER_INTERVAL") updatePulseCounters();
+				else if(i->first == "DEBOUNCE_TIME") updateDebouncedInputs();
 
 				configChanged = true;
 			}
@@ -1045,8 +1897,8 @@ PVariable MyPeer::setValue(BaseLib::PRpcClientInfo clientInfo, uint32_t channel,
 		PParameter rpcParameter = parameterIterator->second.rpcParameter;
 		if(!rpcParameter) return Variable::createError(-5, "Unknown parameter.");
 		BaseLib::Systems::RpcConfigurationParameter& parameter = parameterIterator->second;
-		std::shared_ptr<std::vector<std::string>> valueKeys(new std::vector<std::string>());
-		std::shared_ptr<std::vector<PVariable>> values(new std::vector<PVariable>());
+		std::shared_ptr<std::vector<std::string>> valueKeys;
+		std::shared_ptr<std::vector<PVariable>> values;
 
 		if(value->floatValue == 0)
 		{
@@ -1061,7 +1913,7 @@ PVariable MyPeer::setValue(BaseLib::PRpcClientInfo clientInfo, uint32_t channel,
 			parameter.setBinaryData(parameterData);
 			if(parameter.databaseId > 0) saveParameter(parameter.databaseId, parameterData);
 			else saveParameter(0, ParameterGroup::Type::Enum::variables, channel, valueKey, parameterData);
-			if(!valueKeys->empty())
+			if(valueKeys && !valueKeys->empty())
 			{
                 valueKeys->push_back(valueKey);
                 values->push_back(rpcParameter->convertFromPacket(parameterData, parameter.mainRole(), true));
@@ -1075,8 +1927,64 @@ PVariable MyPeer::setValue(BaseLib::PRpcClientInfo clientInfo, uint32_t channel,
         if(rpcParameter->setPackets.empty() && !rpcParameter->writeable) return Variable::createError(-6, "parameter is read only");
 
         if(channel == 0) return Variable::createError(-2, "Invalid channel.");
+        if(valueKey == "PULSE" || valueKey == "BLINK") return setTimedOutput(channel, valueKey, value);
 
-		if(rpcParameter->logical->type == ILogical::Type::Enum::tBoolean)
+		//{{{ Fast path: Native values are merged directly into the write buffer using the cached output descriptor.
+		bool outputWritten = false;
+		OutputChannel outputChannel;
+		bool outputChannelFound = false;
+		{
+			std::lock_guard<std::mutex> outputChannelsGuard(_outputChannelsMutex);
+			auto outputChannelIterator = _outputChannels.find(channel);
+			if(outputChannelIterator != _outputChannels.end() && outputChannelIterator->second.valueKey == valueKey)
+			{
+				outputChannel = outputChannelIterator->second;
+				outputChannelFound = true;
+			}
+		}
+		if(outputChannelFound)
+		{
+			if(outputChannel.boolean && value->type == VariableType::tBoolean)
+			{
+				setOutput(outputChannel, value->booleanValue ? 1 : 0);
+				outputWritten = true;
+			}
+			else if(!outputChannel.boolean && (value->type == VariableType::tFloat || value->type == VariableType::tInteger || value->type == VariableType::tInteger64))
+			{
+				if(outputChannel.scale)
+				{
+					double floatValue = BaseLib::Math::clamp(value->floatValue, outputChannel.inputMin, outputChannel.inputMax);
+					setOutput(outputChannel, (uint16_t)(int16_t)std::lround(BaseLib::Math::scale(floatValue, outputChannel.inputMin, outputChannel.inputMax, outputChannel.outputMin, outputChannel.outputMax)));
+					if(value->type != VariableType::tFloat || floatValue != value->floatValue) value = std::make_shared<Variable>(floatValue);
+				}
+				else
+				{
+					setOutput(outputChannel, (uint16_t)(int16_t)std::lround(value->floatValue));
+					if(value->type != VariableType::tFloat) value = std::make_shared<Variable>(value->floatValue);
+				}
+				outputWritten = true;
+			}
+
+			if(outputWritten && _superFastMode)
+			{
+				//Nothing is saved or raised in SUPER_FAST_MODE, but getValue() still needs to return the new value.
+				std::vector<uint8_t> parameterData;
+				rpcParameter->convertToPacket(value, parameter.mainRole(), parameterData);
+				parameter.setBinaryData(parameterData);
+				return std::make_shared<Variable>(VariableType::tVoid);
+			}
+		}
+		//}}}
+
+		valueKeys = std::make_shared<std::vector<std::string>>();
+		values = std::make_shared<std::vector<PVariable>>();
+
+		if(outputWritten)
+		{
+			valueKeys->push_back(valueKey);
+			values->push_back(value);
+		}
+		else if(rpcParameter->logical->type == ILogical::Type::Enum::tBoolean)
 		{
             std::vector<uint8_t> parameterData;
             rpcParameter->convertToPacket(value, parameter.mainRole(), parameterData);
@@ -1177,25 +2085,8 @@ PVariable MyPeer::setValue(BaseLib::PRpcClientInfo clientInfo, uint32_t channel,
 			_physicalInterface->sendPacket(packet);
 		}
 
-		bool fastMode = false;
-		bool superFastMode = false;
-		auto configChannelIterator = configCentral.find(0);
-		if(configChannelIterator != configCentral.end())
-		{
-			auto parameterIterator2 = configChannelIterator->second.find("FAST_MODE");
-			if(parameterIterator2 != configChannelIterator->second.end() && parameterIterator2->second.rpcParameter)
-			{
-				std::vector<uint8_t> parameterData = parameterIterator2->second.getBinaryData();
-				fastMode = parameterIterator2->second.rpcParameter->convertFromPacket(parameterData, parameterIterator2->second.mainRole(), false)->booleanValue;
-			}
-            parameterIterator2 = configChannelIterator->second.find("SUPER_FAST_MODE");
-			if(parameterIterator2 != configChannelIterator->second.end() && parameterIterator2->second.rpcParameter)
-			{
-				std::vector<uint8_t> parameterData = parameterIterator2->second.getBinaryData();
-				superFastMode = parameterIterator2->second.rpcParameter->convertFromPacket(parameterData, parameterIterator2->second.mainRole(), false)->booleanValue;
-			}
-		}
-
+		bool fastMode = _fastMode;
+		bool superFastMode = _superFastMode;
 
 		std::vector<uint8_t> parameterData;
 		rpcParameter->convertToPacket(value, parameter.mainRole(), parameterData);
@@ -1212,9 +2103,12 @@ PVariable MyPeer::setValue(BaseLib::PRpcClientInfo clientInfo, uint32_t channel,
 
 		if(!superFastMode && !valueKeys->empty())
 		{
-            std::string address(_serialNumber + ":" + std::to_string(channel));
-            raiseEvent(clientInfo->initInterfaceId, _peerID, channel, valueKeys, values);
-            raiseRPCEvent(clientInfo->initInterfaceId, _peerID, channel, address, valueKeys, values);
+            auto eventAddresses = getEventAddresses();
+            if(channel < eventAddresses->channelAddresses.size())
+            {
+                raiseEvent(clientInfo->initInterfaceId, _peerID, channel, valueKeys, values);
+                raiseRPCEvent(clientInfo->initInterfaceId, _peerID, channel, eventAddresses->channelAddresses[channel], valueKeys, values);
+            }
 		}
 
 		return std::make_shared<Variable>(VariableType::tVoid);
@@ -8,6 +8,7 @@
 #include <homegear-base/BaseLib.h>
 
 #include <list>
+#include <map>
 
 using namespace BaseLib;
 using namespace BaseLib::DeviceDescription;
@@ -36,6 +37,12 @@ public:
 
 	std::shared_ptr<MainInterface>& getPhysicalInterface() { return _physicalInterface; }
 
+	/**
+	 * Rebuilds everything derived from the configuration like the analog input ranges, output channels, fast modes, poll
+	 * interval, pulse counters and debounce times. Called by load() and after creating a peer at runtime.
+	 */
+	void updateCaches();
+
     size_t getInputAddress();
 	void setInputAddress(size_t value);
     size_t getOutputAddress();
@@ -46,10 +53,21 @@ public:
 	uint64_t getNextPeerId() { return _nextPeerId; }
 	void setNextPeerId(uint64_t value);
 	int32_t getInputMemorySize() { if(!_rpcDevice) return -1; return _rpcDevice->memorySize; }
+
+	/**
+	 * Returns how often the inputs of this peer need to be read in milliseconds. 0 means every cycle.
+	 */
+	int32_t getPollInterval() { return _pollInterval; }
     int32_t getOutputMemorySize() { if(!_rpcDevice) return -1; return _rpcDevice->memorySize2; }
 
 	virtual std::string handleCliCommand(std::string command);
 	void packetReceived(std::vector<uint16_t>& packet);
+
+	/**
+	 * Called periodically by the central. Publishes pulse counters and debounced inputs that are due. Returns the time in
+	 * milliseconds after which it needs to be called again or -1 when there is no deadline.
+	 */
+	int32_t worker();
 	void setOutputData();
 
 	virtual bool load(BaseLib::Systems::ICentral* central);
@@ -76,11 +94,102 @@ public:
 	virtual PVariable putParamset(BaseLib::PRpcClientInfo clientInfo, int32_t channel, ParameterGroup::Type::Enum type, uint64_t remoteID, int32_t remoteChannel, PVariable variables, bool checkAcls, bool onlyPushing = false);
 	PVariable setInterface(BaseLib::PRpcClientInfo clientInfo, std::string interfaceId);
 	virtual PVariable setValue(BaseLib::PRpcClientInfo clientInfo, uint32_t channel, std::string valueKey, PVariable value, bool wait);
+
+	/**
+	 * {@inheritDoc}
+	 */
+	virtual PVariable getValue(PRpcClientInfo clientInfo, uint32_t channel, std::string valueKey, bool requestFromDevice, bool asynchronous);
 	//End RPC methods
 protected:
 	const uint16_t _bitMask[16] = { 0b0000000000000001, 0b0000000000000010, 0b0000000000000100, 0b0000000000001000, 0b0000000000010000, 0b0000000000100000, 0b0000000001000000, 0b0000000010000000, 0b0000000100000000, 0b0000001000000000, 0b0000010000000000, 0b0000100000000000, 0b0001000000000000, 0b0010000000000000, 0b0100000000000000, 0b1000000000000000 };
 	const uint16_t _reversedBitMask[16] = { 0b1111111111111110, 0b1111111111111101, 0b1111111111111011, 0b1111111111110111, 0b1111111111101111, 0b1111111111011111, 0b1111111110111111, 0b1111111101111111, 0b1111111011111111, 0b1111110111111111, 0b1111101111111111, 0b1111011111111111, 0b1110111111111111, 0b1101111111111111, 0b1011111111111111, 0b0111111111111111 };
 
+	/**
+	 * Everything setValue() needs to write an output channel without decoding configuration parameters.
+	 */
+	struct OutputChannel
+	{
+		std::string valueKey;
+		bool boolean = false;
+		uint32_t statesIndex = 0;
+		uint32_t bitIndex = 0;
+		bool scale = false;
+		double inputMin = 0;
+		double inputMax = 0;
+		double outputMin = 0;
+		double outputMax = 0;
+	};
+
+	/**
+	 * Event source and channel addresses as passed to raiseEvent() and raiseRPCEvent(). Never modified after creation.
+	 */
+	struct EventAddresses
+	{
+		std::string serialNumber;
+		std::string eventSource;
+		std::vector<std::string> channelAddresses;
+	};
+
+	/**
+	 * Conversion parameters and publishing state of all analog input channels, so packetReceived() needs no map lookups.
+	 * Protected by _analogInputsMutex.
+	 */
+	struct AnalogInputs
+	{
+		std::vector<int32_t> channels;
+		std::vector<uint32_t> registerIndexes;
+		std::vector<uint8_t> isSigned;
+		std::vector<double> inputMin;
+		std::vector<double> inputMax;
+		std::vector<double> outputMin;
+		std::vector<double> outputMax;
+		std::vector<double> decimalFactors;
+		std::vector<int32_t> intervals;
+		std::vector<BaseLib::Systems::RpcConfigurationParameter*> parameters; //Points into valuesCentral
+		std::vector<const std::string*> names; //Key of the parameter in valuesCentral
+		std::vector<int64_t> lastConverted; //Time the channel was last converted
+		std::vector<double> lastValues; //Last published value
+		std::vector<uint8_t> hasLastValue; //False until the first value was compared with the binary data
+	};
+
+	/**
+	 * Changed input value collected by packetReceived() before the events are raised. name points to the key in
+	 * valuesCentral.
+	 */
+	struct StagedValue
+	{
+		int32_t channel;
+		const std::string* name;
+		PVariable value;
+	};
+
+	/**
+	 * Edge counter of a digital input channel. COUNTER_MODE 1 counts rising edges, 2 falling edges and 3 both. The edges
+	 * are counted by the physical interface, the total is baseCount plus the interface's count.
+	 */
+	struct PulseCounter
+	{
+		int32_t mode = 0;
+		int32_t interval = 1000; //Publish interval in milliseconds
+		uint32_t bit = 0; //Bit in the input image
+		uint64_t baseCount = 0; //Count before the interface's counter was registered
+		uint64_t lastCount = 0; //Count at the last frequency calculation
+		int64_t lastPublished = 0;
+		bool unsaved = false; //COUNTER or FREQUENCY changed since the last save
+	};
+
+	/**
+	 * Debounce state of a digital input channel. A change is only published after the input kept the new value for
+	 * debounceTime milliseconds.
+	 */
+	struct DebouncedInput
+	{
+		int32_t debounceTime = 0;
+		bool pending = false;
+		bool value = false; //Pending value
+		int64_t since = 0; //Time the pending value was first seen
+	};
+
 	//In table variables:
 	std::mutex _statesMutex;
 	std::vector<uint16_t> _states;
@@ -92,15 +201,53 @@ protected:
 	uint64_t _nextPeerId = 0;
 	size_t _inputAddress = 0;
     size_t _outputAddress = 0;
-	std::mutex _lastDataMutex;
-	std::map<int32_t, int64_t> _lastData;
 	std::map<int32_t, int32_t> _intervals;
+	std::atomic<int32_t> _pollInterval{0}; //Shortest INTERVAL of all channels
 	std::map<int32_t, int32_t> _decimalPlaces;
 	std::map<int32_t, int32_t> _minimumInputValues;
 	std::map<int32_t, int32_t> _maximumInputValues;
 	std::map<int32_t, int32_t> _minimumOutputValues;
 	std::map<int32_t, int32_t> _maximumOutputValues;
 
+	std::mutex _analogInputsMutex;
+	std::shared_ptr<AnalogInputs> _analogInputs;
+
+	std::atomic_bool _fastMode{false};
+	std::atomic_bool _superFastMode{false};
+	std::mutex _outputChannelsMutex;
+	std::unordered_map<uint32_t, OutputChannel> _outputChannels;
+
+	std::atomic_bool _hasPulseCounters{false};
+	std::mutex _pulseCountersMutex;
+	std::unordered_map<int32_t, PulseCounter> _pulseCounters;
+	std::shared_ptr<MainInterface> _pulseCounterInterface; //Interface the counters are registered with
+	const int32_t _counterSaveInterval = 10000; //Maximum time published counter values stay unsaved
+	int64_t _lastCounterSave = 0;
+
+	std::atomic_bool _hasDebouncedInputs{false};
+	std::mutex _debounceMutex; //Locked after _statesMutex when both are needed
+	std::unordered_map<int32_t, DebouncedInput> _debouncedInputs;
+
+	//{{{ Load shedding
+	const int32_t _deferredSaveInterval = 10000; //Maximum time variables stay unsaved from tier 2 on
+	const int32_t _coalescedEventInterval = 1000; //Interval of analog events in tier 3
+	std::atomic_bool _hasDeferredValues{false};
+	std::mutex _deferredValuesMutex;
+	std::map<std::pair<int32_t, std::string>, PVariable> _deferredSaves; //Not yet encoded values of variables changed while saving was deferred
+	std::map<int32_t, std::map<std::string, PVariable>> _coalescedEvents; //Latest analog values not published yet
+	int64_t _firstDeferredSave = 0;
+	int64_t _firstCoalescedEvent = 0;
+	//}}}
+
+	//{{{ Reused by packetReceived() in every cycle, so their capacity is only allocated once. Only accessed by the thread
+	//    calling packetReceived().
+	std::vector<StagedValue> _stagedValues;
+	std::vector<uint8_t> _encodeBuffer;
+	//}}}
+
+	std::mutex _eventAddressesMutex;
+	std::shared_ptr<EventAddresses> _eventAddresses;
+
 	std::shared_ptr<BaseLib::Rpc::RpcEncoder> _binaryEncoder;
     std::shared_ptr<BaseLib::Rpc::RpcDecoder> _binaryDecoder;
 
@@ -111,6 +258,74 @@ protected:
 
     virtual void setPhysicalInterface(std::shared_ptr<MainInterface> interface);
 
+    /**
+     * Returns the cached event addresses. They are rebuilt when the serial number changed.
+     */
+    std::shared_ptr<EventAddresses> getEventAddresses();
+
+    void updateAnalogInputs();
+    void updatePollInterval();
+
+    /**
+     * Converts the raw value of the analog input channel at position index of analogInputs.
+     */
+    static double scaleAnalogInput(const AnalogInputs& analogInputs, size_t index, uint16_t rawValue);
+
+    /**
+     * Registers the counter channels with the physical interface. Counts of already registered counters are kept.
+     */
+    void updatePulseCounters();
+
+    /**
+     * Unregisters all counters from the physical interface and adds their counts to baseCount. Expects
+     * _pulseCountersMutex to be locked.
+     */
+    void unregisterPulseCounters();
+    bool isPulseCounter(int32_t channel);
+    void publishPulseCounters();
+
+    /**
+     * Saves COUNTER and FREQUENCY of all counters published since the last save. Unless force is set, this happens at
+     * most every _counterSaveInterval milliseconds.
+     */
+    void savePulseCounters(bool force);
+
+    void updateDebouncedInputs();
+
+    /**
+     * Returns true when the change of a debounced channel must not be published yet.
+     */
+    bool holdInput(int32_t channel, bool value, int64_t now);
+    void cancelBouncedInputs(const std::vector<uint16_t>& packet);
+    int32_t publishDebouncedInputs();
+
+    /**
+     * Encodes and saves a changed variable using encodeBuffer or, from load shedding tier 2 on, keeps the native value to be
+     * encoded and saved by worker().
+     */
+    void saveValue(int32_t channel, const std::string& name, BaseLib::Systems::RpcConfigurationParameter& parameter, const PVariable& value, int32_t loadSheddingTier, std::vector<uint8_t>& encodeBuffer);
+
+    /**
+     * Stores the encoded deferred value of the variable in its binary data, so RPC getters return the current value.
+     */
+    void encodeDeferredValue(uint32_t channel, const std::string& name);
+
+    /**
+     * Saves deferred variables and raises coalesced events when they are due, the tier dropped or flush is set. Returns
+     * the time in milliseconds until it needs to be called again or -1.
+     */
+    int32_t publishDeferredValues(bool flush);
+
+    void updateFastModes();
+    void updateOutputChannels();
+    void setOutput(const OutputChannel& outputChannel, uint16_t value);
+
+    /**
+     * Handles PULSE (duration in milliseconds) and BLINK (durations in milliseconds, alternating between on and off,
+     * repeated until stopped). A duration of 0, an empty pattern or false stops the timed output.
+     */
+    PVariable setTimedOutput(uint32_t channel, const std::string& valueKey, const PVariable& value);
+
 	virtual std::shared_ptr<BaseLib::Systems::ICentral> getCentral();
 
 	virtual PParameterGroup getParameterSet(int32_t channel, ParameterGroup::Type::Enum type);
@@ -20,6 +20,52 @@ MainInterface::MainInterface(std::shared_ptr<BaseLib::Systems::PhysicalInterface
 
 	memset(&_bk9000Info, 0, sizeof(_bk9000Info));
 
+	auto statusIntervalSetting = GD::family->getFamilySetting("statusinterval");
+	if(statusIntervalSetting) _statusInterval = statusIntervalSetting->integerValue;
+
+	uint32_t historySize = 1000;
+	auto historySizeSetting = GD::family->getFamilySetting("historysize");
+	if(historySizeSetting && historySizeSetting->integerValue >= 0) historySize = historySizeSetting->integerValue;
+	_history.resize(historySize);
+
+	auto recordingPathSetting = GD::family->getFamilySetting("recordingpath");
+	if(recordingPathSetting && !recordingPathSetting->stringValue.empty() && isListedInSetting("recordinterfaces"))
+	{
+		uint32_t fileSize = 64;
+		uint32_t fileCount = 10;
+		auto fileSizeSetting = GD::family->getFamilySetting("recordingfilesize");
+		if(fileSizeSetting && fileSizeSetting->integerValue > 0) fileSize = fileSizeSetting->integerValue;
+		auto fileCountSetting = GD::family->getFamilySetting("recordingfilecount");
+		if(fileCountSetting && fileCountSetting->integerValue > 0) fileCount = fileCountSetting->integerValue;
+		if(fileSize > 2047) fileSize = 2047;
+		_recorder.reset(new ProcessImageRecorder(settings->id, recordingPathSetting->stringValue, fileSize * 1024 * 1024, fileCount));
+	}
+
+	if(isListedInSetting("sharedmemoryinterfaces"))
+	{
+		auto sharedMemoryWritesSetting = GD::family->getFamilySetting("sharedmemorywrites");
+		_sharedMemoryExport.reset(new SharedMemoryExport(settings->id, sharedMemoryWritesSetting && sharedMemoryWritesSetting->integerValue != 0));
+		_sharedMemoryWriteRequests.reserve(SharedMemoryExport::writeSlotCount);
+	}
+
+	auto loadSheddingBudgetSetting = GD::family->getFamilySetting("loadsheddingbudget");
+	if(loadSheddingBudgetSetting && loadSheddingBudgetSetting->integerValue > 0 && _settings->interval > 0) _loadSheddingBudget = (int64_t)_settings->interval * 10 * loadSheddingBudgetSetting->integerValue;
+	auto maxLoadSheddingTierSetting = GD::family->getFamilySetting("maxloadsheddingtier");
+	if(maxLoadSheddingTierSetting && maxLoadSheddingTierSetting->integerValue >= 1 && maxLoadSheddingTierSetting->integerValue <= 3) _maxLoadSheddingTier = maxLoadSheddingTierSetting->integerValue;
+
+	auto interlockRulesFileSetting = GD::family->getFamilySetting("interlockrulesfile");
+	if(interlockRulesFileSetting && !interlockRulesFileSetting->stringValue.empty() && BaseLib::Io::fileExists(interlockRulesFileSetting->stringValue))
+	{
+		std::string error;
+		std::unique_ptr<InterlockEngine> interlockEngine(new InterlockEngine());
+		if(!interlockEngine->load(BaseLib::Io::getFileContent(interlockRulesFileSetting->stringValue), settings->id, error)) _out.printError("Error: Could not load interlock rules from " + interlockRulesFileSetting->stringValue + ": " + error + " No interlock rule is executed.");
+		else if(interlockEngine->ruleCount() > 0)
+		{
+			_out.printInfo("Info: Loaded " + std::to_string(interlockEngine->ruleCount()) + " interlock rules.");
+			_interlockEngine = std::move(interlockEngine);
+		}
+	}
+
 	signal(SIGPIPE, SIG_IGN);
 }
 
@@ -28,6 +74,18 @@ MainInterface::~MainInterface()
 	stopListening();
 }
 
+bool MainInterface::isListedInSetting(const std::string& settingName)
+{
+	auto setting = GD::family->getFamilySetting(settingName);
+	if(!setting) return false;
+	std::vector<std::string> interfaceIds = BaseLib::HelperFunctions::splitAll(setting->stringValue, ',');
+	for(auto& interfaceId : interfaceIds)
+	{
+		if(BaseLib::HelperFunctions::trim(interfaceId) == _settings->id) return true;
+	}
+	return false;
+}
+
 uint32_t MainInterface::getMessageCounter()
 {
 	return _messageCounter.load(std::memory_order_acquire);
@@ -50,10 +108,14 @@ void MainInterface::startListening()
 	try
 	{
 		stopListening();
-		init();
+		//init() is executed by the listen thread, so one unreachable coupler doesn't delay the startup of all others.
 		_stopCallbackThread = false;
+		//The listen thread uses the recorder and the shared memory segment without locking, so both are set up first.
+		if(_recorder) _recorder->start();
+		if(_sharedMemoryExport) _sharedMemoryExport->open();
 		if(_settings->listenThreadPriority > -1) _bl->threadManager.start(_listenThread, true, _settings->listenThreadPriority, _settings->listenThreadPolicy, &MainInterface::listen, this);
 		else _bl->threadManager.start(_listenThread, true, &MainInterface::listen, this);
+		_bl->threadManager.start(_processingThread, true, &MainInterface::processPackets, this);
 		IPhysicalInterface::startListening();
 	}
     catch(const std::exception& ex)
@@ -68,6 +130,14 @@ void MainInterface::stopListening()
 	{
 		_stopCallbackThread = true;
 		_bl->threadManager.join(_listenThread);
+		_processingConditionVariable.notify_all();
+		_bl->threadManager.join(_processingThread);
+		{
+			std::lock_guard<std::mutex> processingGuard(_processingMutex);
+			_pendingPacket.reset();
+		}
+		if(_recorder) _recorder->stop();
+		if(_sharedMemoryExport) _sharedMemoryExport->close();
 		_stopped = true;
 		{
 			std::lock_guard<std::mutex> modbusGuard(_modbusMutex);
@@ -86,6 +156,7 @@ void MainInterface::init()
 	std::lock_guard<std::mutex> modbusGuard(_modbusMutex);
 	try
     {
+		_freshInputs = false;
 		_modbus->disconnect();
 		if(_settings->host.empty())
 		{
@@ -93,8 +164,17 @@ void MainInterface::init()
 			return;
 		}
 
-		_hostname = _settings->host;
-		_ipAddress = BaseLib::Net::resolveHostname(_hostname);
+		if(_ipAddress.empty() || _hostname != _settings->host)
+		{
+			_hostname = _settings->host;
+			_ipAddress = BaseLib::Net::resolveHostname(_hostname);
+
+			//Connect to the resolved address, so reconnects don't need to resolve the hostname again.
+			BaseLib::Modbus::ModbusInfo modbusInfo;
+			modbusInfo.hostname = _ipAddress;
+			modbusInfo.port = BaseLib::Math::getNumber(_settings->port);
+			_modbus = std::make_shared<BaseLib::Modbus>(_bl, modbusInfo);
+		}
 
 		try
 		{
@@ -102,27 +182,15 @@ void MainInterface::init()
 		}
 		catch(const std::exception& ex)
 		{
+			_ipAddress.clear(); //Resolve again on the next try in case the address changed.
 			_out.printError("Error: Could not connect to BK90x0: " + std::string(ex.what()));
 			return;
 		}
 
-		std::vector<uint16_t> infoBuffer(sizeof(_bk9000Info) / 2); //Size is an even number so division by 2 works
         memset(&_bk9000Info, 0, sizeof(_bk9000Info));
 		try
 		{
-			_modbus->readHoldingRegisters(0x1000, infoBuffer, infoBuffer.size());
-            for(int32_t i = 0; i < 7; i++)
-            {
-                _bk9000Info.busCouplerId[i * 2] = (char)(uint8_t)(infoBuffer[i] & 0xFF);
-                _bk9000Info.busCouplerId[(i * 2) + 1] = (char)(uint8_t)(infoBuffer[i] >> 8);
-            }
-            _bk9000Info.spsInterface = infoBuffer[10];
-            _bk9000Info.diag = infoBuffer[11];
-            _bk9000Info.status = infoBuffer[12];
-            _bk9000Info.analogOutputBits = infoBuffer[16];
-            _bk9000Info.analogInputBits = infoBuffer[17];
-            _bk9000Info.digitalOutputBits = infoBuffer[18];
-            _bk9000Info.digitalInputBits = infoBuffer[19];
+			readInfo(_bk9000Info);
 		}
 		catch(const std::exception& ex)
 		{
@@ -131,49 +199,14 @@ void MainInterface::init()
 			return;
 		}
 
-        //Reset Watchdog
-		try
-		{
-			_modbus->writeSingleRegister(0x1121, 0xBECF);
-			_modbus->writeSingleRegister(0x1121, 0xAFFE);
-
-			_modbus->writeSingleRegister(0x1121, 1);
-		}
-		catch(const std::exception& ex)
-		{
-			_out.printError("Error: Could not set watchdog type: " + std::string(ex.what()));
-			_modbus->disconnect();
-			return;
-		}
-
-        if((_bk9000Info.busCouplerId[7] == 0x42 && _bk9000Info.busCouplerId[8] >= 0x43) || _bk9000Info.busCouplerId[7] > 0x42)
+        if(!writeWatchdogSettings())
         {
-        	_out.printInfo("Info: Enabling \"Fast Modbus\"...");
-			try
-			{
-				_modbus->writeSingleRegister(0x1123, 1); //Fast Modbus
-			}
-			catch(const std::exception& ex)
-			{
-				_out.printError("Error: Could not set TCP mode to \"Fast Modbus\": " + std::string(ex.what()));
-			}
+        	_modbus->disconnect();
+        	return;
         }
 
-		try
-		{
-			_modbus->writeSingleRegister(0x1120, _settings->watchdogTimeout);
-		}
-		catch(const std::exception& ex)
-		{
-			_out.printInfo("Info: Could not set watchdog interval: " + std::string(ex.what()));
-		}
-
-        if(_bk9000Info.status != 0)
-        {
-        	if(_bk9000Info.status & 0x80) _out.printCritical("Critical: Bus error");
-        	else if(_bk9000Info.status & 0x02) _out.printCritical("Critical: Bus coupler configuration error");
-        	else if(_bk9000Info.status & 0x01) _out.printCritical("Critical: Bus device error");
-        }
+        _busCouplerStatus.store(0, std::memory_order_relaxed);
+        checkStatus(_bk9000Info.diag, _bk9000Info.status);
 
         int32_t inputRegisters = (_bk9000Info.analogInputBits + _bk9000Info.digitalInputBits) / 16 + ((_bk9000Info.analogInputBits + _bk9000Info.digitalInputBits) % 16 != 0 ? 1 : 0);
         int32_t outputRegisters = (_bk9000Info.analogOutputBits + _bk9000Info.digitalOutputBits) / 16 + ((_bk9000Info.analogOutputBits + _bk9000Info.digitalOutputBits) % 16 != 0 ? 1 : 0);
@@ -187,9 +220,14 @@ void MainInterface::init()
         {
             std::lock_guard<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
             _writeBuffer.resize(outputRegisters, 0);
+            _writeBufferGeneration.fetch_add(1, std::memory_order_acq_rel);
         }
 
+        reserveHistory(inputRegisters, outputRegisters);
+        if(_recorder) _recorder->setLayout(_bk9000Info.analogInputBits, _bk9000Info.analogOutputBits, _bk9000Info.digitalInputBits, _bk9000Info.digitalOutputBits);
+
         _out.printInfo("Info: Connected to BK90x0. ID: " + std::string(_bk9000Info.busCouplerId, 12) + ", analog input bits: " + std::to_string(_bk9000Info.analogInputBits) + ", analog output bits: " + std::to_string(_bk9000Info.analogOutputBits) + ", digital input bits: " + std::to_string(_bk9000Info.digitalInputBits) + ", digital output bits: " + std::to_string(_bk9000Info.digitalOutputBits));
+        _initialized = true;
         _stopped = false;
         return;
     }
@@ -200,10 +238,318 @@ void MainInterface::init()
     _modbus->disconnect();
 }
 
+void MainInterface::readInfo(Bk9000Info& info)
+{
+	std::vector<uint16_t> infoBuffer(sizeof(Bk9000Info) / 2); //Size is an even number so division by 2 works
+	_modbus->readHoldingRegisters(0x1000, infoBuffer, infoBuffer.size());
+	for(int32_t i = 0; i < 7; i++)
+	{
+		info.busCouplerId[i * 2] = (char)(uint8_t)(infoBuffer[i] & 0xFF);
+		info.busCouplerId[(i * 2) + 1] = (char)(uint8_t)(infoBuffer[i] >> 8);
+	}
+	info.spsInterface = infoBuffer[10];
+	info.diag = infoBuffer[11];
+	info.status = infoBuffer[12];
+	info.analogOutputBits = infoBuffer[16];
+	info.analogInputBits = infoBuffer[17];
+	info.digitalOutputBits = infoBuffer[18];
+	info.digitalInputBits = infoBuffer[19];
+}
+
+bool MainInterface::writeWatchdogSettings()
+{
+	//Reset Watchdog
+	try
+	{
+		_modbus->writeSingleRegister(0x1121, 0xBECF);
+		_modbus->writeSingleRegister(0x1121, 0xAFFE);
+
+		_modbus->writeSingleRegister(0x1121, 1);
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printError("Error: Could not set watchdog type: " + std::string(ex.what()));
+		return false;
+	}
+
+	if((_bk9000Info.busCouplerId[7] == 0x42 && _bk9000Info.busCouplerId[8] >= 0x43) || _bk9000Info.busCouplerId[7] > 0x42)
+	{
+		_out.printInfo("Info: Enabling \"Fast Modbus\"...");
+		try
+		{
+			_modbus->writeSingleRegister(0x1123, 1); //Fast Modbus
+		}
+		catch(const std::exception& ex)
+		{
+			_out.printError("Error: Could not set TCP mode to \"Fast Modbus\": " + std::string(ex.what()));
+		}
+	}
+
+	try
+	{
+		_modbus->writeSingleRegister(0x1120, _settings->watchdogTimeout);
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printInfo("Info: Could not set watchdog interval: " + std::string(ex.what()));
+	}
+	return true;
+}
+
+void MainInterface::reconnect()
+{
+	std::unique_lock<std::mutex> modbusGuard(_modbusMutex);
+	try
+	{
+		if(_ipAddress.empty())
+		{
+			//The last try failed, so the hostname is resolved again by init().
+			modbusGuard.unlock();
+			init();
+			return;
+		}
+
+		//Fast path: Reuse the resolved hostname, the watchdog configuration and the buffers. Only the info block is reread
+		//to make sure we are still talking to the same coupler with the same terminal layout.
+		_freshInputs = false;
+		_modbus->disconnect();
+		_modbus->connect();
+
+		Bk9000Info info;
+		memset(&info, 0, sizeof(info));
+		readInfo(info);
+
+		if(memcmp(info.busCouplerId, _bk9000Info.busCouplerId, sizeof(info.busCouplerId)) == 0 &&
+			info.analogInputBits == _bk9000Info.analogInputBits &&
+			info.analogOutputBits == _bk9000Info.analogOutputBits &&
+			info.digitalInputBits == _bk9000Info.digitalInputBits &&
+			info.digitalOutputBits == _bk9000Info.digitalOutputBits)
+		{
+			//A power cycled coupler keeps its ID and layout but loses the watchdog configuration.
+			std::vector<uint16_t> watchdogTimeout(1);
+			_modbus->readHoldingRegisters(0x1120, watchdogTimeout, 1);
+			if(watchdogTimeout[0] != (uint16_t)_settings->watchdogTimeout)
+			{
+				_out.printInfo("Info: Watchdog configuration was reset. Writing it again.");
+				if(!writeWatchdogSettings())
+				{
+					_modbus->disconnect();
+					return;
+				}
+			}
+
+			_bk9000Info.diag = info.diag;
+			_bk9000Info.status = info.status;
+			checkStatus(info.diag, info.status);
+			_out.printInfo("Info: Reconnected to BK90x0.");
+			_stopped = false;
+			return;
+		}
+
+		_out.printWarning("Warning: Bus coupler ID or layout changed. Reinitializing connection.");
+	}
+	catch(const std::exception& ex)
+	{
+		//Fall back to a full initialization, which resolves the hostname again in case the address changed.
+		_modbus->disconnect();
+		_ipAddress.clear();
+		if(GD::bl->debugLevel >= 5) _out.printDebug("Debug: Could not reconnect to BK90x0: " + std::string(ex.what()));
+	}
+
+	modbusGuard.unlock();
+	init();
+}
+
+void MainInterface::checkStatus(uint16_t diag, uint16_t status)
+{
+	_busCouplerDiag.store(diag, std::memory_order_relaxed);
+	uint16_t previousStatus = _busCouplerStatus.exchange(status, std::memory_order_relaxed);
+	if(status == previousStatus) return;
+
+	if(status & 0x80) _out.printCritical("Critical: Bus error");
+	else if(status & 0x02) _out.printCritical("Critical: Bus coupler configuration error");
+	else if(status & 0x01) _out.printCritical("Critical: Bus device error");
+	else if(status == 0) _out.printInfo("Info: Bus coupler status is OK again.");
+}
+
+void MainInterface::readStatus()
+{
+	std::vector<uint16_t> statusBuffer(2);
+	_modbus->readHoldingRegisters(0x100B, statusBuffer, statusBuffer.size());
+	_bk9000Info.diag = statusBuffer[0];
+	_bk9000Info.status = statusBuffer[1];
+	checkStatus(statusBuffer[0], statusBuffer[1]);
+}
+
+//{{{ Process image history
+void MainInterface::reserveHistory(uint32_t inputRegisters, uint32_t outputRegisters)
+{
+	try
+	{
+		std::lock_guard<std::mutex> historyGuard(_historyMutex);
+		for(auto& processImage : _history)
+		{
+			processImage.inputs.reserve(inputRegisters);
+			processImage.outputs.reserve(outputRegisters);
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MainInterface::recordHistory(int64_t time, const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs)
+{
+	if(_history.empty()) return;
+	std::lock_guard<std::mutex> historyGuard(_historyMutex);
+	ProcessImage& processImage = _history[_historyPosition];
+	processImage.time = time;
+	processImage.inputs.assign(inputs.begin(), inputs.end());
+	processImage.outputs.assign(outputs.begin(), outputs.end());
+	_historyPosition = (_historyPosition + 1) % _history.size();
+	if(_historyCount < _history.size()) _historyCount++;
+}
+
+std::vector<MainInterface::ProcessImage> MainInterface::getHistory(int64_t startTime, int64_t endTime, uint32_t startRegister, uint32_t registerCount)
+{
+	std::vector<ProcessImage> history;
+	try
+	{
+		if(_history.empty()) return history;
+
+		uint32_t count = 0;
+		uint32_t position = 0;
+		{
+			std::lock_guard<std::mutex> historyGuard(_historyMutex);
+			count = _historyCount;
+			position = (_historyPosition + _history.size() - _historyCount) % _history.size();
+		}
+
+		//The lock is only held while copying one slot, so the listen thread is never blocked for long. Slots overwritten
+		//in the meantime are newer than endTime or are skipped because their time is out of order.
+		int64_t lastTime = 0;
+		for(uint32_t i = 0; i < count; i++)
+		{
+			std::lock_guard<std::mutex> historyGuard(_historyMutex);
+			ProcessImage& processImage = _history[(position + i) % _history.size()];
+			if(processImage.time < startTime || processImage.time > endTime || processImage.time < lastTime) continue;
+			lastTime = processImage.time;
+
+			ProcessImage slice;
+			slice.time = processImage.time;
+			if(startRegister < processImage.inputs.size())
+			{
+				uint32_t inputCount = std::min(registerCount, (uint32_t)processImage.inputs.size() - startRegister);
+				slice.inputs.assign(processImage.inputs.begin() + startRegister, processImage.inputs.begin() + startRegister + inputCount);
+			}
+			if(startRegister < processImage.outputs.size())
+			{
+				uint32_t outputCount = std::min(registerCount, (uint32_t)processImage.outputs.size() - startRegister);
+				slice.outputs.assign(processImage.outputs.begin() + startRegister, processImage.outputs.begin() + startRegister + outputCount);
+			}
+			history.push_back(std::move(slice));
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return history;
+}
+//}}}
+
+void MainInterface::setReadPlan(const std::vector<ReadRange>& readPlan)
+{
+	try
+	{
+		std::lock_guard<std::mutex> readPlanGuard(_readPlanMutex);
+		_readPlan = readPlan;
+		if(_interlockEngine)
+		{
+			//The registers used by interlock rules are read every cycle regardless of the peers' poll intervals.
+			for(auto registerIndex : _interlockEngine->getInputRegisters())
+			{
+				ReadRange range;
+				range.startRegister = registerIndex;
+				range.registerCount = 1;
+				_readPlan.push_back(range);
+			}
+		}
+		_readPlanSet = true;
+		_readPlanGeneration.fetch_add(1, std::memory_order_acq_rel);
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+bool MainInterface::pollRange(const ReadRange& range, std::vector<uint16_t>& readBuffer, std::vector<uint16_t>& rangeBuffer, std::vector<uint16_t>& writeBuffer)
+{
+	if(range.startRegister >= readBuffer.size()) return false;
+	uint32_t endRegister = std::min(range.startRegister + range.registerCount, (uint32_t)readBuffer.size());
+	bool writeOutputs = !writeBuffer.empty() && writeBuffer.size() <= _maxReadWriteRegisters;
+	bool outputsWritten = false;
+
+	for(uint32_t startRegister = range.startRegister; startRegister < endRegister; startRegister += _maxReadRegisters)
+	{
+		uint32_t registerCount = std::min(endRegister - startRegister, _maxReadRegisters);
+		rangeBuffer.resize(registerCount);
+
+		try
+		{
+			if(writeOutputs) _modbus->readWriteMultipleRegisters(startRegister, rangeBuffer, registerCount, 0x800, writeBuffer, writeBuffer.size());
+			else _modbus->readHoldingRegisters(startRegister, rangeBuffer, registerCount);
+		}
+		catch(const std::exception& ex)
+		{
+			//Retry once before tearing down the connection
+			if(writeOutputs) _modbus->readWriteMultipleRegisters(startRegister, rangeBuffer, registerCount, 0x800, writeBuffer, writeBuffer.size());
+			else _modbus->readHoldingRegisters(startRegister, rangeBuffer, registerCount);
+		}
+
+		std::copy(rangeBuffer.begin(), rangeBuffer.end(), readBuffer.begin() + startRegister);
+		if(writeOutputs)
+		{
+			outputsWritten = true;
+			writeOutputs = false;
+		}
+	}
+
+	return outputsWritten;
+}
+
+void MainInterface::writeOutputs(std::vector<uint16_t>& writeBuffer)
+{
+	for(uint32_t startRegister = 0; startRegister < writeBuffer.size(); startRegister += _maxWriteRegisters)
+	{
+		uint32_t registerCount = std::min((uint32_t)writeBuffer.size() - startRegister, _maxWriteRegisters);
+		std::vector<uint16_t>* chunk = &writeBuffer;
+		if(registerCount != writeBuffer.size())
+		{
+			_writeChunk.assign(writeBuffer.begin() + startRegister, writeBuffer.begin() + startRegister + registerCount);
+			chunk = &_writeChunk;
+		}
+
+		try
+		{
+			_modbus->writeMultipleRegisters(0x800 + startRegister, *chunk, registerCount);
+		}
+		catch(const std::exception& ex)
+		{
+			//Retry once before tearing down the connection
+			_modbus->writeMultipleRegisters(0x800 + startRegister, *chunk, registerCount);
+		}
+	}
+}
+
 void MainInterface::listen()
 {
     try
     {
+    	init();
+
     	int64_t startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
     	int64_t endTime;
     	int64_t timeToSleep;
@@ -214,15 +560,40 @@ void MainInterface::listen()
             readBuffer.resize(_readBuffer.size(), 0);
         }
 
+        //Snapshot of _writeBuffer. It is only copied when the buffer was modified, so the lock is never held during I/O.
+        std::vector<uint16_t> writeBuffer;
+        uint64_t writeBufferGeneration = 0;
+        std::vector<uint16_t> noOutputs;
+
+        //Snapshot of _readPlan with the time of the next read of each range
+        std::vector<ScheduledRange> schedule;
+        uint64_t readPlanGeneration = 0;
+        std::vector<ReadRange> dueRanges;
+        std::vector<uint16_t> rangeBuffer;
+        int64_t nextStatusRead = BaseLib::HelperFunctions::getTime() + _statusInterval;
+        uint64_t recordedWriteBufferGeneration = 0;
+        uint64_t droppedImages = _droppedImages.load(std::memory_order_relaxed);
+
         while(!_stopCallbackThread)
         {
         	try
         	{
 				if(_stopped || !_modbus)
 				{
-					std::this_thread::sleep_for(std::chrono::milliseconds(2000));
-					init();
+					//Jittered exponential backoff. The first attempts happen within a few milliseconds so a single dropped
+					//segment doesn't cost us seconds of blind time.
+					if(_reconnectDelay == 0) _reconnectDelay = _minReconnectDelay;
+					else
+					{
+						_reconnectDelay *= 2;
+						if(_reconnectDelay > _maxReconnectDelay) _reconnectDelay = _maxReconnectDelay;
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(BaseLib::HelperFunctions::getRandomNumber(_reconnectDelay / 2, _reconnectDelay)));
 					if(_stopCallbackThread) return;
+					if(_initialized) reconnect();
+					else init();
+					if(!_stopped) _reconnectDelay = 0;
+					readPlanGeneration = 0; //Read all ranges right away
 					continue;
 				}
 
@@ -232,62 +603,153 @@ void MainInterface::listen()
                     readBufferEmpty = _readBuffer.empty();
                 }
 
-				if(readBufferEmpty)
+				if(_sharedMemoryExport)
 				{
-                    std::shared_lock<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
-					if(_outputsEnabled && !_writeBuffer.empty())
+					_sharedMemoryExport->takeWriteRequests(_sharedMemoryWriteRequests);
+					for(auto& request : _sharedMemoryWriteRequests)
 					{
-						try
-						{
-							_modbus->writeMultipleRegisters(0x800, _writeBuffer, _writeBuffer.size());
-						}
-						catch(const std::exception& ex)
-						{
-							_stopped = true;
-							continue;
-						}
+						setOutputBits(request.startBit, request.bitCount, request.value);
 					}
 				}
-				else
+
+				if(_timedOutputCount.load(std::memory_order_acquire) > 0) processTimedOutputs(BaseLib::HelperFunctions::getTimeMicroseconds());
+
+				//Interlock rules are executed last, so they override setValue, timed outputs and shared memory writes. They are
+				//skipped until the inputs were read after connecting, as the buffer is zero filled or stale before that.
+				if(_interlockEngine && _freshInputs && !readBufferEmpty && !readBuffer.empty())
+				{
+					std::lock_guard<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+					if(_interlockEngine->execute(readBuffer, _writeBuffer)) _writeBufferGeneration.fetch_add(1, std::memory_order_acq_rel);
+				}
+
+				if(_writeBufferGeneration.load(std::memory_order_acquire) != writeBufferGeneration)
 				{
-                    std::shared_lock<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+					std::shared_lock<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+					writeBuffer = _writeBuffer;
+					writeBufferGeneration = _writeBufferGeneration.load(std::memory_order_acquire);
+				}
+
+                if(!readBufferEmpty)
+                {
                     {
                         std::shared_lock<std::shared_timed_mutex> readBufferGuard(_readBufferMutex);
                         if(readBuffer.size() != _readBuffer.size()) readBuffer.resize(_readBuffer.size(), 0);
                     }
 
-					//std::cerr << 'W' << BaseLib::HelperFunctions::getHexString(_writeBuffer) << std::endl;
-					try
-					{
-						if(_outputsEnabled && !_writeBuffer.empty()) _modbus->readWriteMultipleRegisters(0x0, readBuffer, readBuffer.size(), 0x800, _writeBuffer, _writeBuffer.size());
-						else _modbus->readHoldingRegisters(0x0, readBuffer, readBuffer.size());
-					}
-					catch(std::exception& ex)
-					{
-						_stopped = true;
-						continue;
-					}
+                    if(_readPlanGeneration.load(std::memory_order_acquire) != readPlanGeneration)
+                    {
+                        std::lock_guard<std::mutex> readPlanGuard(_readPlanMutex);
+                        readPlanGeneration = _readPlanGeneration.load(std::memory_order_acquire);
+                        schedule.clear();
+                        if(_readPlanSet)
+                        {
+                            schedule.reserve(_readPlan.size());
+                            for(auto& range : _readPlan)
+                            {
+                                ScheduledRange scheduledRange;
+                                static_cast<ReadRange&>(scheduledRange) = range;
+                                schedule.push_back(scheduledRange);
+                            }
+                            std::sort(schedule.begin(), schedule.end(), [](const ScheduledRange& a, const ScheduledRange& b) { return a.startRegister < b.startRegister; });
+                        }
+                        else
+                        {
+                            ScheduledRange scheduledRange;
+                            scheduledRange.registerCount = readBuffer.size();
+                            schedule.push_back(scheduledRange);
+                        }
+                    }
+                }
 
-					_lastPacketSent = BaseLib::HelperFunctions::getTime();
-					_lastPacketReceived = _lastPacketSent.load();
+                int64_t now = BaseLib::HelperFunctions::getTime();
+                int32_t loadSheddingTier = _loadSheddingTier.load(std::memory_order_relaxed);
+                dueRanges.clear();
+                if(!readBufferEmpty)
+                {
+                    for(auto& range : schedule)
+                    {
+                        if(now < range.nextRead) continue;
+                        //Ranges read every cycle contain the digital inputs and the interlock registers, so they are never slowed down.
+                        range.nextRead = now + (range.interval > 0 && loadSheddingTier >= 1 ? range.interval * _slowRangeFactor : range.interval);
+
+                        //Ranges due in the same cycle are merged when they touch, so they are read with one request.
+                        if(!dueRanges.empty() && range.startRegister <= dueRanges.back().startRegister + dueRanges.back().registerCount)
+                        {
+                            uint32_t endRegister = std::max(dueRanges.back().startRegister + dueRanges.back().registerCount, range.startRegister + range.registerCount);
+                            dueRanges.back().registerCount = endRegister - dueRanges.back().startRegister;
+                        }
+                        else dueRanges.push_back(range);
+                    }
+                }
+
+                //std::cerr << 'W' << BaseLib::HelperFunctions::getHexString(writeBuffer) << std::endl;
+                try
+                {
+                    //The outputs are written together with the first read request if possible.
+                    bool outputsWritten = !_outputsEnabled || writeBuffer.empty();
+                    for(auto& range : dueRanges)
+                    {
+                        if(pollRange(range, readBuffer, rangeBuffer, outputsWritten ? noOutputs : writeBuffer)) outputsWritten = true;
+                    }
+                    if(!outputsWritten) writeOutputs(writeBuffer);
+
+                    if(_statusInterval > 0 && now >= nextStatusRead)
+                    {
+                        nextStatusRead = now + _statusInterval;
+                        readStatus();
+                    }
+                }
+                catch(const std::exception& ex)
+                {
+                    _stopped = true;
+                    continue;
+                }
+
+                bool inputsChanged = false;
+                if(!dueRanges.empty())
+                {
+                    _freshInputs = true;
+                    if(_edgeCounterCount.load(std::memory_order_acquire) > 0) countEdges(readBuffer);
+                    _lastPacketSent = BaseLib::HelperFunctions::getTime();
+                    _lastPacketReceived = _lastPacketSent.load();
                     std::shared_lock<std::shared_timed_mutex> readBufferGuard(_readBufferMutex);
-					if(!std::equal(readBuffer.begin(), readBuffer.end(), _readBuffer.begin()))
-					{
+                    if(!std::equal(readBuffer.begin(), readBuffer.end(), _readBuffer.begin()))
+                    {
                         readBufferGuard.unlock();
+                        inputsChanged = true;
                         {
                             std::lock_guard<std::shared_timed_mutex> readBufferGuard2(_readBufferMutex);
                             _readBuffer = readBuffer;
                         }
-						//std::cerr << 'R' << BaseLib::HelperFunctions::getHexString(readBuffer) << std::endl;
-						std::shared_ptr<MyPacket> packet(new MyPacket(0, readBuffer.size() * 8 - 1, readBuffer));
-						raisePacketReceived(packet);
-					}
-				}
+                        //std::cerr << 'R' << BaseLib::HelperFunctions::getHexString(readBuffer) << std::endl;
+                        std::shared_ptr<MyPacket> packet = getPooledPacket();
+                        packet->reset(0, readBuffer.size() * 16 - 1, readBuffer);
+                        queuePacket(packet);
+                    }
+                }
 
+				recordHistory(BaseLib::HelperFunctions::getTime(), readBuffer, writeBuffer);
+				if(_recorder && (inputsChanged || recordedWriteBufferGeneration != writeBufferGeneration))
+				{
+					if(_recorder->record(BaseLib::HelperFunctions::getTimeMicroseconds(), readBuffer, writeBuffer)) recordedWriteBufferGeneration = writeBufferGeneration;
+				}
+				if(_sharedMemoryExport) _sharedMemoryExport->publish(BaseLib::HelperFunctions::getTimeMicroseconds(), readBuffer, writeBuffer);
 				_messageCounter.fetch_add(1, std::memory_order_acq_rel);
 
 				endTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+				if(_loadSheddingBudget > 0)
+				{
+					uint64_t currentDroppedImages = _droppedImages.load(std::memory_order_relaxed);
+					updateLoadShedding(endTime - startTime, currentDroppedImages != droppedImages);
+					droppedImages = currentDroppedImages;
+				}
 				timeToSleep = (_settings->interval * 1000) - (endTime - startTime);
+				if(_timedOutputCount.load(std::memory_order_acquire) > 0)
+				{
+					//Start the next cycle when a timed output switches, so the timing doesn't depend on the poll interval.
+					int64_t timeToNextStep = _nextTimedOutputStep.load(std::memory_order_acquire) - endTime;
+					if(timeToNextStep < timeToSleep) timeToSleep = timeToNextStep;
+				}
 				if(timeToSleep < 500) timeToSleep = 500;
 				std::this_thread::sleep_for(std::chrono::microseconds(timeToSleep));
 				startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
@@ -304,11 +766,123 @@ void MainInterface::listen()
     }
 }
 
+std::shared_ptr<MyPacket> MainInterface::getPooledPacket()
+{
+	{
+		std::lock_guard<std::mutex> processingGuard(_processingMutex);
+		if(!_freePackets.empty())
+		{
+			std::shared_ptr<MyPacket> packet = std::move(_freePackets.back());
+			_freePackets.pop_back();
+			return packet;
+		}
+	}
+	return std::make_shared<MyPacket>();
+}
+
+void MainInterface::releasePacket(std::shared_ptr<MyPacket>& packet)
+{
+	//One packet can be pending and one can be processed, so the pool normally never grows beyond three packets.
+	std::lock_guard<std::mutex> processingGuard(_processingMutex);
+	if(_freePackets.size() < 4) _freePackets.push_back(std::move(packet));
+	packet.reset();
+}
+
+void MainInterface::updateLoadShedding(int64_t cycleTime, bool imagesDropped)
+{
+	try
+	{
+		int64_t averageCycleTime = _averageCycleTime.load(std::memory_order_relaxed);
+		averageCycleTime += (cycleTime - averageCycleTime) / 8;
+		_averageCycleTime.store(averageCycleTime, std::memory_order_relaxed);
+
+		//A dropped image means the peers can't keep up with decoding, saving and raising events even if the cycle itself is fast.
+		int32_t tier = _loadSheddingTier.load(std::memory_order_relaxed);
+		if(averageCycleTime > _loadSheddingBudget || imagesDropped)
+		{
+			_recoveredCycles = 0;
+			if(tier >= _maxLoadSheddingTier || ++_overrunCycles < _escalationCycles) return;
+			_overrunCycles = 0;
+			tier++;
+			_loadSheddingTier.store(tier, std::memory_order_relaxed);
+			if(averageCycleTime > _loadSheddingBudget) _out.printWarning("Warning: Average cycle time of " + std::to_string(averageCycleTime) + " microseconds exceeds the budget of " + std::to_string(_loadSheddingBudget) + " microseconds. Entering load shedding tier " + std::to_string(tier) + ".");
+			else _out.printWarning("Warning: Input images are dropped, because the peers can't keep up. Entering load shedding tier " + std::to_string(tier) + ".");
+		}
+		else if(averageCycleTime < _loadSheddingBudget * 3 / 4)
+		{
+			_overrunCycles = 0;
+			if(tier == 0 || ++_recoveredCycles < _recoveryCycles) return;
+			_recoveredCycles = 0;
+			tier--;
+			_loadSheddingTier.store(tier, std::memory_order_relaxed);
+			_out.printInfo("Info: Average cycle time is " + std::to_string(averageCycleTime) + " microseconds. Returning to load shedding tier " + std::to_string(tier) + ".");
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MainInterface::queuePacket(std::shared_ptr<MyPacket>& packet)
+{
+	try
+	{
+		std::lock_guard<std::mutex> processingGuard(_processingMutex);
+		if(_pendingPacket)
+		{
+			//The consumer lags behind. Only the newest image is kept.
+			_droppedImages.fetch_add(1, std::memory_order_relaxed);
+			std::vector<uint16_t>& pendingData = _pendingPacket->getData();
+			std::vector<uint16_t>& data = packet->getData();
+			uint32_t droppedValues = 0;
+			for(uint32_t i = 0; i < pendingData.size() && i < data.size(); i++)
+			{
+				if(pendingData[i] != data[i]) droppedValues++;
+			}
+			_droppedValues.fetch_add(droppedValues, std::memory_order_relaxed);
+			if(_freePackets.size() < 4) _freePackets.push_back(std::move(_pendingPacket));
+		}
+		_pendingPacket = packet;
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	_processingConditionVariable.notify_one();
+}
+
+void MainInterface::processPackets()
+{
+	while(!_stopCallbackThread)
+	{
+		try
+		{
+			std::shared_ptr<MyPacket> packet;
+			{
+				std::unique_lock<std::mutex> processingGuard(_processingMutex);
+				_processingConditionVariable.wait_for(processingGuard, std::chrono::milliseconds(1000), [&] { return _pendingPacket || _stopCallbackThread; });
+				packet.swap(_pendingPacket);
+			}
+			if(packet)
+			{
+				raisePacketReceived(packet);
+				releasePacket(packet);
+			}
+		}
+		catch(const std::exception& ex)
+		{
+			_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+		}
+	}
+}
+
 void MainInterface::setOutputData(std::shared_ptr<MyPacket> packet)
 {
 	try
 	{
         std::lock_guard<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+		_writeBufferGeneration.fetch_add(1, std::memory_order_acq_rel);
 		while(packet->getStartRegister() >= _writeBuffer.size()) _writeBuffer.push_back(0);
 
 		int32_t startRegister = packet->getStartRegister();
@@ -345,6 +919,229 @@ void MainInterface::setOutputData(std::shared_ptr<MyPacket> packet)
     }
 }
 
+void MainInterface::setOutputBits(uint32_t startBit, uint32_t bitCount, uint16_t value)
+{
+	try
+	{
+		if(bitCount == 0 || bitCount > 16) return;
+		uint32_t startRegister = startBit / 16;
+		uint32_t mask = ((1u << bitCount) - 1) << (startBit % 16);
+		uint32_t data = ((uint32_t)value << (startBit % 16)) & mask;
+
+		std::lock_guard<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+		if(startRegister >= _writeBuffer.size())
+		{
+			_out.printError("Error: Invalid start register: " + std::to_string(startRegister));
+			return;
+		}
+		_writeBufferGeneration.fetch_add(1, std::memory_order_acq_rel);
+		if(!_timedOutputs.empty()) eraseTimedOutputs(startBit, bitCount, false);
+		_writeBuffer[startRegister] = (_writeBuffer[startRegister] & ~(uint16_t)mask) | (uint16_t)data;
+		if((mask >> 16) && startRegister + 1 < _writeBuffer.size())
+		{
+			_writeBuffer[startRegister + 1] = (_writeBuffer[startRegister + 1] & ~(uint16_t)(mask >> 16)) | (uint16_t)(data >> 16);
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+//{{{ Timed outputs
+void MainInterface::setWriteBufferBit(uint32_t bit, bool value)
+{
+	uint32_t index = bit / 16;
+	if(index >= _writeBuffer.size()) return;
+	if(value) _writeBuffer[index] |= _bitMask[bit % 16];
+	else _writeBuffer[index] &= _reversedBitMask[bit % 16];
+	_writeBufferGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool MainInterface::eraseTimedOutputs(uint32_t startBit, uint32_t bitCount, bool restore)
+{
+	bool erased = false;
+	for(auto i = _timedOutputs.begin(); i != _timedOutputs.end();)
+	{
+		if(i->bit >= startBit && i->bit < startBit + bitCount)
+		{
+			if(restore) setWriteBufferBit(i->bit, i->restoreValue);
+			i = _timedOutputs.erase(i);
+			erased = true;
+		}
+		else ++i;
+	}
+	if(erased) updateNextTimedOutputStep();
+	return erased;
+}
+
+void MainInterface::updateNextTimedOutputStep()
+{
+	int64_t nextStep = 0;
+	for(auto& timedOutput : _timedOutputs)
+	{
+		if(nextStep == 0 || timedOutput.nextStep < nextStep) nextStep = timedOutput.nextStep;
+	}
+	_nextTimedOutputStep.store(nextStep, std::memory_order_release);
+	_timedOutputCount.store(_timedOutputs.size(), std::memory_order_release);
+}
+
+void MainInterface::startTimedOutput(uint32_t bit, const std::vector<int32_t>& pattern, bool repeat)
+{
+	try
+	{
+		if(pattern.empty()) return;
+		std::lock_guard<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+		if(bit / 16 >= _writeBuffer.size())
+		{
+			_out.printError("Error: Invalid output bit for timed output: " + std::to_string(bit));
+			return;
+		}
+
+		TimedOutput timedOutput;
+		timedOutput.bit = bit;
+		timedOutput.restoreValue = _writeBuffer[bit / 16] & _bitMask[bit % 16];
+		for(auto& existingTimedOutput : _timedOutputs)
+		{
+			//Return to the value before the first timed output, not to an intermediate step.
+			if(existingTimedOutput.bit == bit) timedOutput.restoreValue = existingTimedOutput.restoreValue;
+		}
+		eraseTimedOutputs(bit, 1, false);
+
+		timedOutput.repeat = repeat;
+		timedOutput.pattern = pattern;
+		//The pattern alternates between on and off, so a repeated pattern needs an even number of steps.
+		if(repeat && pattern.size() % 2 == 1) timedOutput.pattern.insert(timedOutput.pattern.end(), pattern.begin(), pattern.end());
+		for(auto& duration : timedOutput.pattern)
+		{
+			if(duration < 1) duration = 1;
+		}
+		timedOutput.nextStep = BaseLib::HelperFunctions::getTimeMicroseconds() + (int64_t)timedOutput.pattern.front() * 1000;
+		setWriteBufferBit(bit, true);
+		_timedOutputs.push_back(std::move(timedOutput));
+		updateNextTimedOutputStep();
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MainInterface::stopTimedOutput(uint32_t bit)
+{
+	try
+	{
+		if(_timedOutputCount.load(std::memory_order_acquire) == 0) return;
+		std::lock_guard<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+		eraseTimedOutputs(bit, 1, true);
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void MainInterface::processTimedOutputs(int64_t now)
+{
+	try
+	{
+		if(now < _nextTimedOutputStep.load(std::memory_order_acquire)) return;
+		std::lock_guard<std::shared_timed_mutex> writeBufferGuard(_writeBufferMutex);
+		for(auto i = _timedOutputs.begin(); i != _timedOutputs.end();)
+		{
+			bool finished = false;
+			//The next step is calculated from the planned time of the previous one, so cycle jitter doesn't accumulate.
+			while(now >= i->nextStep)
+			{
+				i->step++;
+				if(i->step >= i->pattern.size())
+				{
+					if(!i->repeat)
+					{
+						finished = true;
+						break;
+					}
+					i->step = 0;
+				}
+				i->nextStep += (int64_t)i->pattern[i->step] * 1000;
+			}
+
+			if(finished)
+			{
+				setWriteBufferBit(i->bit, i->restoreValue);
+				i = _timedOutputs.erase(i);
+				continue;
+			}
+			setWriteBufferBit(i->bit, i->step % 2 == 0);
+			++i;
+		}
+		updateNextTimedOutputStep();
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+//}}}
+
+//{{{ Edge counters
+void MainInterface::addEdgeCounter(uint32_t bit, int32_t mode)
+{
+	try
+	{
+		std::lock_guard<std::mutex> edgeCountersGuard(_edgeCountersMutex);
+		EdgeCounter& edgeCounter = _edgeCounters[bit];
+		edgeCounter.mode = mode;
+		_edgeCounterCount.store(_edgeCounters.size(), std::memory_order_release);
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+uint64_t MainInterface::removeEdgeCounter(uint32_t bit)
+{
+	try
+	{
+		std::lock_guard<std::mutex> edgeCountersGuard(_edgeCountersMutex);
+		auto edgeCounterIterator = _edgeCounters.find(bit);
+		if(edgeCounterIterator == _edgeCounters.end()) return 0;
+		uint64_t count = edgeCounterIterator->second.count;
+		_edgeCounters.erase(edgeCounterIterator);
+		_edgeCounterCount.store(_edgeCounters.size(), std::memory_order_release);
+		return count;
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return 0;
+}
+
+uint64_t MainInterface::getEdgeCount(uint32_t bit)
+{
+	std::lock_guard<std::mutex> edgeCountersGuard(_edgeCountersMutex);
+	auto edgeCounterIterator = _edgeCounters.find(bit);
+	return edgeCounterIterator == _edgeCounters.end() ? 0 : edgeCounterIterator->second.count;
+}
+
+void MainInterface::countEdges(const std::vector<uint16_t>& inputs)
+{
+	std::lock_guard<std::mutex> edgeCountersGuard(_edgeCountersMutex);
+	for(auto& edgeCounterIterator : _edgeCounters)
+	{
+		uint32_t index = edgeCounterIterator.first / 16;
+		if(index >= inputs.size()) continue;
+		EdgeCounter& edgeCounter = edgeCounterIterator.second;
+		bool value = inputs[index] & _bitMask[edgeCounterIterator.first % 16];
+		if(edgeCounter.valueKnown && value != edgeCounter.value && ((value && (edgeCounter.mode & 1)) || (!value && (edgeCounter.mode & 2)))) edgeCounter.count++;
+		edgeCounter.value = value;
+		edgeCounter.valueKnown = true;
+	}
+}
+//}}}
+
 void MainInterface::sendPacket(std::shared_ptr<BaseLib::Systems::Packet> packet)
 {
 	try
@@ -360,6 +1157,8 @@ void MainInterface::sendPacket(std::shared_ptr<BaseLib::Systems::Packet> packet)
 			_out.printError("Error: Packet has invalid start register: " + std::to_string(myPacket->getStartRegister()));
 			return;
 		}
+		_writeBufferGeneration.fetch_add(1, std::memory_order_acq_rel);
+		if(!_timedOutputs.empty()) eraseTimedOutputs(myPacket->getStartBit(), myPacket->getEndBit() - myPacket->getStartBit() + 1, false);
 
 		int32_t startRegister = myPacket->getStartRegister();
 		int32_t endRegister = myPacket->getEndRegister();
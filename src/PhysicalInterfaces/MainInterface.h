@@ -4,8 +4,12 @@
 #define MAININTERFACE_H_
 
 #include "../MyPacket.h"
+#include "../InterlockEngine.h"
+#include "../ProcessImageRecorder.h"
+#include "../SharedMemoryExport.h"
 #include <homegear-base/BaseLib.h>
 
+#include <condition_variable>
 #include <shared_mutex>
 
 namespace MyFamily {
@@ -13,11 +17,31 @@ namespace MyFamily {
 class MainInterface : public BaseLib::Systems::IPhysicalInterface
 {
 public:
+	/**
+	 * A range of input registers polled at its own rate.
+	 */
+	struct ReadRange
+	{
+		uint32_t startRegister = 0;
+		uint32_t registerCount = 0;
+		int32_t interval = 0; //In milliseconds. 0 means every cycle.
+	};
+
+	/**
+	 * The input and output registers of one cycle.
+	 */
+	struct ProcessImage
+	{
+		int64_t time = 0; //In milliseconds
+		std::vector<uint16_t> inputs;
+		std::vector<uint16_t> outputs;
+	};
+
 	MainInterface(std::shared_ptr<BaseLib::Systems::PhysicalInterfaceSettings> settings);
 	virtual ~MainInterface();
 
-	void startListening();
-	void stopListening();
+	virtual void startListening();
+	virtual void stopListening();
 
 	void enableOutputs() { _outputsEnabled = true; }
 	uint32_t digitalInputOffset() { return _bk9000Info.analogInputBits; }
@@ -30,11 +54,66 @@ public:
 	bool isOpen() { return !_stopped; }
 
 	uint32_t getMessageCounter();
+	uint64_t getDroppedImages() { return _droppedImages.load(std::memory_order_relaxed); }
+	uint64_t getDroppedValues() { return _droppedValues.load(std::memory_order_relaxed); }
+	uint16_t getBusCouplerStatus() { return _busCouplerStatus.load(std::memory_order_relaxed); }
+	uint16_t getBusCouplerDiag() { return _busCouplerDiag.load(std::memory_order_relaxed); }
+	bool isRecording() { return (bool)_recorder; }
+	uint64_t getDroppedRecords() { return _recorder ? _recorder->getDroppedImages() : 0; }
+	size_t getInterlockRuleCount() { return _interlockEngine ? _interlockEngine->ruleCount() : 0; }
+	bool isLoadSheddingEnabled() { return _loadSheddingBudget > 0; }
+	int64_t getAverageCycleTime() { return _averageCycleTime.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns the active load shedding tier. 0 means normal operation. From tier 1 on slow ranges are read less often,
+	 * from tier 2 on peers defer saving variables and in tier 3 analog events are coalesced.
+	 */
+	int32_t getLoadSheddingTier() { return _loadSheddingTier.load(std::memory_order_relaxed); }
+
+	/**
+	 * Sets the input registers to poll. Until a plan is set, the whole input image is read every cycle.
+	 */
+	void setReadPlan(const std::vector<ReadRange>& readPlan);
+
+	/**
+	 * Returns the process images of the cycles between startTime and endTime (milliseconds), oldest first. Only the
+	 * registers from startRegister to startRegister + registerCount - 1 are returned.
+	 */
+	std::vector<ProcessImage> getHistory(int64_t startTime, int64_t endTime, uint32_t startRegister, uint32_t registerCount);
     std::vector<uint16_t> getReadBuffer();
     std::vector<uint16_t> getWriteBuffer();
 
 	void setOutputData(std::shared_ptr<MyPacket> packet);
+
+	/**
+	 * Merges up to 16 bits into the write buffer without creating a packet.
+	 */
+	void setOutputBits(uint32_t startBit, uint32_t bitCount, uint16_t value);
 	void sendPacket(std::shared_ptr<BaseLib::Systems::Packet> packet);
+
+	/**
+	 * Switches an output bit on and off by the listen thread. pattern contains the durations in milliseconds, starting
+	 * with the on phase. With repeat set, the pattern is repeated until stopTimedOutput() is called. Afterwards the bit
+	 * returns to the value it had before. Writing the bit with setOutputBits() also stops the timed output.
+	 */
+	void startTimedOutput(uint32_t bit, const std::vector<int32_t>& pattern, bool repeat);
+	void stopTimedOutput(uint32_t bit);
+
+	/**
+	 * Counts the edges of an input bit in the listen thread on every image read, so no edge is lost when the processing
+	 * thread drops images. mode 1 counts rising edges, 2 falling edges and 3 both.
+	 */
+	void addEdgeCounter(uint32_t bit, int32_t mode);
+
+	/**
+	 * Removes the counter and returns the number of edges it counted.
+	 */
+	uint64_t removeEdgeCounter(uint32_t bit);
+
+	/**
+	 * Returns the number of edges counted since addEdgeCounter().
+	 */
+	uint64_t getEdgeCount(uint32_t bit);
 protected:
 	struct Bk9000Info
 	{
@@ -63,11 +142,179 @@ protected:
 
 	std::shared_timed_mutex _writeBufferMutex;
 	std::vector<uint16_t> _writeBuffer;
+	std::atomic<uint64_t> _writeBufferGeneration{1}; //Incremented on every change of _writeBuffer
 	std::shared_timed_mutex _readBufferMutex;
 	std::vector<uint16_t> _readBuffer;
 
+	//{{{ Timed outputs. Protected by _writeBufferMutex.
+	struct TimedOutput
+	{
+		uint32_t bit = 0;
+		bool restoreValue = false;
+		bool repeat = false;
+		std::vector<int32_t> pattern;
+		uint32_t step = 0;
+		int64_t nextStep = 0; //In microseconds
+	};
+
+	std::vector<TimedOutput> _timedOutputs;
+	std::atomic<uint32_t> _timedOutputCount{0};
+	std::atomic<int64_t> _nextTimedOutputStep{0}; //Earliest nextStep of all timed outputs
+
+	void setWriteBufferBit(uint32_t bit, bool value);
+
+	/**
+	 * Removes the timed outputs overlapping the bits. Returns true when one was removed.
+	 */
+	bool eraseTimedOutputs(uint32_t startBit, uint32_t bitCount, bool restore);
+	void updateNextTimedOutputStep();
+
+	/**
+	 * Executes the steps of the timed outputs that are due. Called by the listen thread before the outputs are written.
+	 */
+	void processTimedOutputs(int64_t now);
+	//}}}
+
+	//{{{ Edge counters. Protected by _edgeCountersMutex.
+	struct EdgeCounter
+	{
+		int32_t mode = 0;
+		uint64_t count = 0;
+		bool value = false;
+		bool valueKnown = false; //False until the bit was read once
+	};
+
+	std::mutex _edgeCountersMutex;
+	std::unordered_map<uint32_t, EdgeCounter> _edgeCounters;
+	std::atomic<uint32_t> _edgeCounterCount{0};
+
+	/**
+	 * Counts the edges between the last and the current image. Called by the listen thread after every read.
+	 */
+	void countEdges(const std::vector<uint16_t>& inputs);
+	//}}}
+
+	//{{{ Handoff between the listen thread and the thread raising the packets
+	std::thread _processingThread;
+	std::mutex _processingMutex;
+	std::condition_variable _processingConditionVariable;
+	std::shared_ptr<MyPacket> _pendingPacket;
+	std::atomic<uint64_t> _droppedImages{0};
+	std::atomic<uint64_t> _droppedValues{0};
+	std::vector<std::shared_ptr<MyPacket>> _freePackets; //Packets handed back by the consumer. Protected by _processingMutex.
+	//}}}
+
+	//{{{ Poll scheduling
+	struct ScheduledRange : ReadRange
+	{
+		int64_t nextRead = 0;
+	};
+
+	std::mutex _readPlanMutex;
+	std::vector<ReadRange> _readPlan;
+	bool _readPlanSet = false;
+	std::atomic<uint64_t> _readPlanGeneration{1}; //Incremented on every change of _readPlan
+	int32_t _statusInterval = 5000;
+	std::atomic<uint16_t> _busCouplerStatus{0};
+	std::atomic<uint16_t> _busCouplerDiag{0};
+	//}}}
+
+	//{{{ Load shedding
+	const int32_t _slowRangeFactor = 4; //Slow ranges are read this many times less often from tier 1 on
+	const uint32_t _escalationCycles = 20; //Overrunning cycles before the next tier is entered
+	const uint32_t _recoveryCycles = 200; //Cycles below 75 % of the budget before the previous tier is entered
+	int64_t _loadSheddingBudget = 0; //In microseconds. 0 disables load shedding.
+	int32_t _maxLoadSheddingTier = 3;
+	std::atomic<int32_t> _loadSheddingTier{0};
+	std::atomic<int64_t> _averageCycleTime{0}; //In microseconds. Moving average written by the listen thread.
+	uint32_t _overrunCycles = 0; //Only accessed by the listen thread
+	uint32_t _recoveredCycles = 0; //Only accessed by the listen thread
+
+	/**
+	 * Changes the tier depending on the time the cycle took and whether the processing thread had to drop an image.
+	 * Called by the listen thread at the end of every cycle.
+	 */
+	void updateLoadShedding(int64_t cycleTime, bool imagesDropped);
+	//}}}
+
+	//Modbus limits of read holding registers (0x03), write multiple registers (0x10) and read/write multiple registers (0x17)
+	const uint32_t _maxReadRegisters = 125;
+	const uint32_t _maxWriteRegisters = 123;
+	const uint32_t _maxReadWriteRegisters = 121;
+	std::vector<uint16_t> _writeChunk; //Only accessed by the listen thread
+
+	//{{{ Process image history
+	std::mutex _historyMutex;
+	std::vector<ProcessImage> _history; //Ring buffer. The slots are allocated once and reused.
+	uint32_t _historyPosition = 0; //Slot written next
+	uint32_t _historyCount = 0; //Number of valid slots
+
+	void reserveHistory(uint32_t inputRegisters, uint32_t outputRegisters);
+	void recordHistory(int64_t time, const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs);
+	//}}}
+
+	std::unique_ptr<ProcessImageRecorder> _recorder; //Only set when recording is enabled for this interface
+	std::unique_ptr<SharedMemoryExport> _sharedMemoryExport; //Only set when the export is enabled for this interface
+	std::vector<SharedMemoryExport::WriteRequest> _sharedMemoryWriteRequests; //Only accessed by the listen thread
+	std::unique_ptr<InterlockEngine> _interlockEngine; //Only set when rules are defined for this interface. Only executed by the listen thread.
+	bool _freshInputs = false; //Set by the first successful read after init() or reconnect(). Only accessed by the listen thread.
+
+	const int32_t _minReconnectDelay = 5;
+	const int32_t _maxReconnectDelay = 2000;
+	std::atomic_bool _initialized{false};
+	int32_t _reconnectDelay = 0;
+
+	/**
+	 * Returns true when the ID of this interface is in the comma separated list of the family setting.
+	 */
+	bool isListedInSetting(const std::string& settingName);
+
 	void init();
+	void readInfo(Bk9000Info& info);
+
+	/**
+	 * Sets the watchdog type, "Fast Modbus" when supported and the watchdog interval. Returns false when the watchdog
+	 * type could not be set.
+	 */
+	bool writeWatchdogSettings();
+
+	/**
+	 * Reconnects without reinitializing when the coupler is unchanged. Falls back to init() otherwise.
+	 */
+	void reconnect();
 	void listen();
+
+	/**
+	 * Reads one range into its position in readBuffer. Ranges exceeding the Modbus limits are split into several
+	 * requests. When writeBuffer is not empty and fits into a read/write request, the outputs are written together with
+	 * the first request and true is returned. Failed requests are retried once before the exception is passed on.
+	 */
+	bool pollRange(const ReadRange& range, std::vector<uint16_t>& readBuffer, std::vector<uint16_t>& rangeBuffer, std::vector<uint16_t>& writeBuffer);
+
+	/**
+	 * Writes the output image in as many requests as needed.
+	 */
+	void writeOutputs(std::vector<uint16_t>& writeBuffer);
+	void readStatus();
+
+	/**
+	 * Logs the coupler status whenever it changes.
+	 */
+	void checkStatus(uint16_t diag, uint16_t status);
+
+	/**
+	 * Hands a changed input image over to the processing thread. If the previous image wasn't processed yet, it is
+	 * replaced and the number of dropped registers is counted.
+	 */
+	void queuePacket(std::shared_ptr<MyPacket>& packet);
+
+	/**
+	 * Returns a free packet of the pool or a new one. Packets are only reused after they were handed back with
+	 * releasePacket(), so the consumer's last access happens before the packet is overwritten.
+	 */
+	std::shared_ptr<MyPacket> getPooledPacket();
+	void releasePacket(std::shared_ptr<MyPacket>& packet);
+	void processPackets();
 };
 
 }
@@ -0,0 +1,321 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#include "ReplayInterface.h"
+#include "../GD.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MyFamily
+{
+
+ReplayInterface::ReplayInterface(std::shared_ptr<BaseLib::Systems::PhysicalInterfaceSettings> settings) : MainInterface(settings)
+{
+	_out.setPrefix(GD::out.getPrefix() + "Beckhoff replay \"" + settings->id + "\": ");
+
+	//Never record a replay. It could overwrite the files being played back.
+	_recorder.reset();
+
+	auto speedSetting = GD::family->getFamilySetting("replayspeed");
+	if(speedSetting && !speedSetting->stringValue.empty()) _speed = BaseLib::Math::getDouble(speedSetting->stringValue);
+	else if(speedSetting) _speed = speedSetting->integerValue;
+	if(_speed < 0) _speed = 0;
+}
+
+ReplayInterface::~ReplayInterface()
+{
+	stopListening();
+}
+
+void ReplayInterface::startListening()
+{
+	try
+	{
+		stopListening();
+		_stopCallbackThread = false;
+		if(_settings->listenThreadPriority > -1) _bl->threadManager.start(_listenThread, true, _settings->listenThreadPriority, _settings->listenThreadPolicy, &ReplayInterface::replay, this);
+		else _bl->threadManager.start(_listenThread, true, &ReplayInterface::replay, this);
+		IPhysicalInterface::startListening();
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void ReplayInterface::stopListening()
+{
+	try
+	{
+		_stopCallbackThread = true;
+		_bl->threadManager.join(_listenThread);
+		_stopped = true;
+		IPhysicalInterface::stopListening();
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+std::vector<ReplayInterface::RecordingFile> ReplayInterface::getRecordingFiles()
+{
+	std::vector<RecordingFile> recordingFiles;
+	try
+	{
+		std::string directory = ".";
+		std::string prefix = _settings->device;
+		auto slashPosition = prefix.find_last_of('/');
+		if(slashPosition != std::string::npos)
+		{
+			directory = prefix.substr(0, slashPosition + 1);
+			prefix = prefix.substr(slashPosition + 1);
+		}
+		if(directory.back() != '/') directory.push_back('/');
+		prefix.push_back('.');
+
+		std::vector<std::string> files = _bl->io.getFiles(directory);
+		for(auto& file : files)
+		{
+			//<prefix>.<index>.hgrec
+			if(file.size() <= prefix.size() + 6 || file.compare(0, prefix.size(), prefix) != 0 || file.compare(file.size() - 6, 6, ".hgrec") != 0) continue;
+			std::string index = file.substr(prefix.size(), file.size() - prefix.size() - 6);
+			if(!BaseLib::Math::isNumber(index)) continue;
+
+			std::string filename = directory + file;
+			int fileDescriptor = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+			if(fileDescriptor == -1) continue;
+			char header[ProcessImageRecorder::sequenceOffset + 8];
+			ssize_t bytesRead = pread(fileDescriptor, header, sizeof(header), 0);
+			close(fileDescriptor);
+			if(bytesRead != (ssize_t)sizeof(header) || memcmp(header, ProcessImageRecorder::magic, sizeof(ProcessImageRecorder::magic)) != 0)
+			{
+				_out.printWarning("Warning: " + filename + " is not a process image recording.");
+				continue;
+			}
+
+			RecordingFile recordingFile;
+			recordingFile.filename = filename;
+			memcpy(&recordingFile.sequence, header + ProcessImageRecorder::sequenceOffset, sizeof(recordingFile.sequence));
+			recordingFiles.push_back(recordingFile);
+		}
+
+		std::sort(recordingFiles.begin(), recordingFiles.end(), [](const RecordingFile& a, const RecordingFile& b) { return a.sequence < b.sequence; });
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return recordingFiles;
+}
+
+bool ReplayInterface::waitFor(int64_t time, int64_t firstTime, int64_t startTime)
+{
+	if(_speed <= 0) return !_stopCallbackThread;
+
+	int64_t dueTime = startTime + (int64_t)((time - firstTime) / _speed);
+	while(!_stopCallbackThread)
+	{
+		int64_t timeToSleep = dueTime - BaseLib::HelperFunctions::getTimeMicroseconds();
+		if(timeToSleep <= 0) return true;
+		//Sleep in small steps, so stopListening() doesn't have to wait for long gaps in the recording.
+		std::this_thread::sleep_for(std::chrono::microseconds(std::min(timeToSleep, (int64_t)100000)));
+	}
+	return false;
+}
+
+void ReplayInterface::replay()
+{
+	try
+	{
+		std::vector<RecordingFile> recordingFiles = getRecordingFiles();
+		if(recordingFiles.empty())
+		{
+			_out.printError("Error: No recording found at \"" + _settings->device + "\". Please set \"device\" in \"beckhoff.conf\" to the recording path followed by the ID of the recorded interface.");
+			return;
+		}
+
+		_out.printInfo("Info: Replaying " + std::to_string(recordingFiles.size()) + " files" + (_speed > 0 ? " at " + std::to_string(_speed) + " times the original speed." : " as fast as possible."));
+		_stopped = false;
+
+		std::vector<uint16_t> inputs;
+		std::vector<uint16_t> outputs;
+		int64_t firstTime = -1;
+		int64_t startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+		uint64_t imageCount = 0;
+		for(auto& recordingFile : recordingFiles)
+		{
+			if(_stopCallbackThread) break;
+			replayFile(recordingFile.filename, inputs, outputs, firstTime, startTime, imageCount);
+		}
+
+		int64_t duration = BaseLib::HelperFunctions::getTimeMicroseconds() - startTime;
+		_out.printInfo("Info: Replay finished. " + std::to_string(imageCount) + " images in " + std::to_string(duration / 1000) + " ms (" + std::to_string(duration > 0 ? (imageCount * 1000000) / duration : 0) + " images per second).");
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	_stopped = true;
+}
+
+void ReplayInterface::replayFile(const std::string& filename, std::vector<uint16_t>& inputs, std::vector<uint16_t>& outputs, int64_t& firstTime, int64_t& startTime, uint64_t& imageCount)
+{
+	int fileDescriptor = -1;
+	uint8_t* mapping = nullptr;
+	size_t fileSize = 0;
+	try
+	{
+		fileDescriptor = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat fileStat{};
+		if(fileDescriptor == -1 || fstat(fileDescriptor, &fileStat) == -1)
+		{
+			_out.printError("Error: Could not open recording file " + filename + ": " + std::string(strerror(errno)));
+			if(fileDescriptor != -1) close(fileDescriptor);
+			return;
+		}
+		fileSize = fileStat.st_size;
+		if(fileSize < ProcessImageRecorder::fileHeaderSize)
+		{
+			close(fileDescriptor);
+			return;
+		}
+		void* fileMapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if(fileMapping == MAP_FAILED)
+		{
+			_out.printError("Error: Could not map recording file " + filename + ": " + std::string(strerror(errno)));
+			close(fileDescriptor);
+			return;
+		}
+		mapping = (uint8_t*)fileMapping;
+
+		uint32_t fileVersion = 0;
+		uint32_t headerSize = 0;
+		uint64_t dataEnd = 0;
+		memcpy(&fileVersion, mapping + 8, sizeof(fileVersion));
+		memcpy(&headerSize, mapping + 12, sizeof(headerSize));
+		memcpy(&dataEnd, mapping + ProcessImageRecorder::dataEndOffset, sizeof(dataEnd));
+		if(fileVersion != ProcessImageRecorder::version || headerSize < ProcessImageRecorder::fileHeaderSize || dataEnd > fileSize)
+		{
+			_out.printError("Error: Unsupported or corrupted recording file " + filename + ".");
+		}
+		else
+		{
+			uint16_t layout[4];
+			memcpy(layout, mapping + ProcessImageRecorder::layoutOffset, sizeof(layout));
+			_bk9000Info.analogInputBits = layout[0];
+			_bk9000Info.analogOutputBits = layout[1];
+			_bk9000Info.digitalInputBits = layout[2];
+			_bk9000Info.digitalOutputBits = layout[3];
+
+			_out.printInfo("Info: Replaying " + filename + "...");
+			bool keyFrameSeen = false;
+			int64_t time = 0;
+			uint64_t position = headerSize;
+			while(position + ProcessImageRecorder::recordHeaderSize <= dataEnd && !_stopCallbackThread)
+			{
+				const uint8_t* record = mapping + position;
+				uint32_t recordSize = 0;
+				uint16_t inputCount = 0;
+				uint16_t outputCount = 0;
+				memcpy(&recordSize, record, sizeof(recordSize));
+				bool keyFrame = record[4] & ProcessImageRecorder::keyFrameFlag;
+				memcpy(&inputCount, record + 6, sizeof(inputCount));
+				memcpy(&outputCount, record + 8, sizeof(outputCount));
+
+				uint32_t registerCount = (uint32_t)inputCount + outputCount;
+				uint32_t timeSize = keyFrame ? 8 : 4;
+				uint32_t valuesOffset = ProcessImageRecorder::recordHeaderSize + timeSize + (registerCount + 7) / 8;
+				if(recordSize < valuesOffset || position + recordSize > dataEnd)
+				{
+					_out.printError("Error: Recording file " + filename + " is corrupted at position " + std::to_string(position) + ".");
+					break;
+				}
+				position += recordSize;
+
+				if(keyFrame)
+				{
+					memcpy(&time, record + ProcessImageRecorder::recordHeaderSize, sizeof(time));
+					keyFrameSeen = true;
+				}
+				else
+				{
+					//Delta frames can only be applied to the image they were recorded after.
+					if(!keyFrameSeen || inputs.size() != inputCount || outputs.size() != outputCount) continue;
+					uint32_t timeDelta = 0;
+					memcpy(&timeDelta, record + ProcessImageRecorder::recordHeaderSize, sizeof(timeDelta));
+					time += timeDelta;
+				}
+
+				bool inputsChanged = inputs.size() != inputCount;
+				inputs.resize(inputCount, 0);
+				outputs.resize(outputCount, 0);
+
+				const uint8_t* mask = record + ProcessImageRecorder::recordHeaderSize + timeSize;
+				uint32_t valuePosition = valuesOffset;
+				for(uint32_t i = 0; i < registerCount; i++)
+				{
+					if(!(mask[i / 8] & (1 << (i % 8)))) continue;
+					if(valuePosition + 2 > recordSize) break;
+					uint16_t value = (uint16_t)record[valuePosition] | ((uint16_t)record[valuePosition + 1] << 8);
+					valuePosition += 2;
+					if(i < inputCount)
+					{
+						if(inputs[i] != value) inputsChanged = true;
+						inputs[i] = value;
+					}
+					else outputs[i - inputCount] = value;
+				}
+
+				if(firstTime == -1)
+				{
+					firstTime = time;
+					startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+				}
+				if(!waitFor(time, firstTime, startTime)) break;
+				raiseImage(inputs, outputs, inputsChanged);
+				imageCount++;
+			}
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	if(mapping) munmap(mapping, fileSize);
+	if(fileDescriptor != -1) close(fileDescriptor);
+}
+
+void ReplayInterface::raiseImage(const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs, bool inputsChanged)
+{
+	try
+	{
+		if(inputsChanged && !inputs.empty())
+		{
+			{
+				std::lock_guard<std::shared_timed_mutex> readBufferGuard(_readBufferMutex);
+				_readBuffer = inputs;
+			}
+			_lastPacketReceived = BaseLib::HelperFunctions::getTime();
+			if(_edgeCounterCount.load(std::memory_order_acquire) > 0) countEdges(inputs);
+
+			//The packet is processed synchronously, so the results don't depend on thread scheduling and no image is
+			//dropped when replaying as fast as possible.
+			std::shared_ptr<MyPacket> packet = getPooledPacket();
+			packet->reset(0, inputs.size() * 16 - 1, inputs);
+			raisePacketReceived(packet);
+			releasePacket(packet);
+		}
+
+		recordHistory(BaseLib::HelperFunctions::getTime(), inputs, outputs);
+		_messageCounter.fetch_add(1, std::memory_order_acq_rel);
+	}
+	catch(const std::exception& ex)
+	{
+		_out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+}
@@ -0,0 +1,53 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#ifndef REPLAYINTERFACE_H_
+#define REPLAYINTERFACE_H_
+
+#include "MainInterface.h"
+
+namespace MyFamily {
+
+/**
+ * Plays back files written by ProcessImageRecorder instead of polling a bus coupler. "device" in the interface settings
+ * is the path of the recording without the file index, e.g. "/var/lib/homegear/beckhoff-recordings/My-BK90x0". The
+ * input images are passed to the central in the listen thread in the order they were recorded, so every run processes
+ * exactly the same packets.
+ */
+class ReplayInterface : public MainInterface
+{
+public:
+	ReplayInterface(std::shared_ptr<BaseLib::Systems::PhysicalInterfaceSettings> settings);
+	virtual ~ReplayInterface();
+
+	virtual void startListening();
+	virtual void stopListening();
+protected:
+	struct RecordingFile
+	{
+		std::string filename;
+		uint64_t sequence = 0;
+	};
+
+	double _speed = 1; //0 replays as fast as possible
+
+	/**
+	 * Returns the files of the recording ordered by their sequence numbers.
+	 */
+	std::vector<RecordingFile> getRecordingFiles();
+
+	/**
+	 * Waits until the image recorded at time (microseconds) is due. Returns false when the interface is stopped.
+	 */
+	bool waitFor(int64_t time, int64_t firstTime, int64_t startTime);
+	void replay();
+
+	/**
+	 * Plays back one file. inputs and outputs hold the last image and are updated record by record.
+	 */
+	void replayFile(const std::string& filename, std::vector<uint16_t>& inputs, std::vector<uint16_t>& outputs, int64_t& firstTime, int64_t& startTime, uint64_t& imageCount);
+	void raiseImage(const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs, bool inputsChanged);
+};
+
+}
+
+#endif
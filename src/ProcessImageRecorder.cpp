@@ -0,0 +1,284 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#include "ProcessImageRecorder.h"
+#include "GD.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace MyFamily
+{
+
+constexpr char ProcessImageRecorder::magic[8];
+
+ProcessImageRecorder::ProcessImageRecorder(const std::string& interfaceId, const std::string& path, uint32_t fileSize, uint32_t fileCount) : _interfaceId(interfaceId), _path(path), _fileSize(fileSize), _fileCount(fileCount)
+{
+	if(!_path.empty() && _path.back() != '/') _path.push_back('/');
+	if(_fileCount == 0) _fileCount = 1;
+	_slots.resize(256);
+}
+
+ProcessImageRecorder::~ProcessImageRecorder()
+{
+	stop();
+}
+
+void ProcessImageRecorder::start()
+{
+	try
+	{
+		stop();
+		_head = 0;
+		_tail = 0;
+		_keyFrameRequired = true;
+		_sequence = (uint64_t)BaseLib::HelperFunctions::getTimeMicroseconds(); //Keeps the files ordered across restarts
+		_stopRecorderThread = false;
+		GD::bl->threadManager.start(_recorderThread, true, &ProcessImageRecorder::recorderThread, this);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void ProcessImageRecorder::stop()
+{
+	try
+	{
+		if(_stopRecorderThread) return;
+		{
+			std::lock_guard<std::mutex> wakeUpGuard(_wakeUpMutex);
+			_stopRecorderThread = true;
+		}
+		_wakeUpConditionVariable.notify_all();
+		GD::bl->threadManager.join(_recorderThread);
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void ProcessImageRecorder::setLayout(uint16_t analogInputBits, uint16_t analogOutputBits, uint16_t digitalInputBits, uint16_t digitalOutputBits)
+{
+	_layout.store((uint64_t)analogInputBits | ((uint64_t)analogOutputBits << 16) | ((uint64_t)digitalInputBits << 32) | ((uint64_t)digitalOutputBits << 48), std::memory_order_relaxed);
+}
+
+bool ProcessImageRecorder::record(int64_t time, const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs)
+{
+	if(_stopRecorderThread) return false;
+	uint32_t tail = _tail.load(std::memory_order_relaxed);
+	uint32_t nextTail = (tail + 1) % _slots.size();
+	if(nextTail == _head.load(std::memory_order_acquire))
+	{
+		_droppedImages.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Slot& slot = _slots[tail];
+	slot.time = time;
+	slot.inputs.assign(inputs.begin(), inputs.end());
+	slot.outputs.assign(outputs.begin(), outputs.end());
+	_tail.store(nextTail, std::memory_order_release);
+	_wakeUpConditionVariable.notify_one();
+	return true;
+}
+
+void ProcessImageRecorder::recorderThread()
+{
+	while(true)
+	{
+		try
+		{
+			{
+				std::unique_lock<std::mutex> wakeUpGuard(_wakeUpMutex);
+				//The timeout covers notifications sent between checking the queue and waiting.
+				_wakeUpConditionVariable.wait_for(wakeUpGuard, std::chrono::milliseconds(100), [&] { return _stopRecorderThread || _head.load(std::memory_order_relaxed) != _tail.load(std::memory_order_acquire); });
+			}
+
+			uint32_t head = _head.load(std::memory_order_relaxed);
+			while(head != _tail.load(std::memory_order_acquire))
+			{
+				const Slot& slot = _slots[head];
+
+				//Make sure the largest possible record fits, so a file always starts with a key frame.
+				uint32_t registerCount = slot.inputs.size() + slot.outputs.size();
+				uint32_t maxRecordSize = recordHeaderSize + 8 + (registerCount + 7) / 8 + registerCount * 2;
+				if(maxRecordSize > _fileSize - fileHeaderSize)
+				{
+					if(!_sizeErrorPrinted) GD::out.printError("Error: Process image of interface " + _interfaceId + " is too large for recording file size " + std::to_string(_fileSize) + ".");
+					_sizeErrorPrinted = true;
+				}
+				else if((_mapping && _position + maxRecordSize <= _fileSize && _fileLayout == _layout.load(std::memory_order_relaxed)) || openNextFile())
+				{
+					encode(slot);
+					if(!_record.empty())
+					{
+						memcpy(_mapping + _position, _record.data(), _record.size());
+						_position += _record.size();
+						uint64_t dataEnd = _position;
+						memcpy(_mapping + dataEndOffset, &dataEnd, sizeof(dataEnd));
+					}
+				}
+
+				head = (head + 1) % _slots.size();
+				_head.store(head, std::memory_order_release);
+			}
+
+			if(_stopRecorderThread) break;
+		}
+		catch(const std::exception& ex)
+		{
+			GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+		}
+	}
+	closeFile();
+}
+
+bool ProcessImageRecorder::openNextFile()
+{
+	try
+	{
+		closeFile();
+
+		std::string filename = _path + _interfaceId + "." + std::to_string(_fileIndex) + ".hgrec";
+		_fileIndex = (_fileIndex + 1) % _fileCount;
+
+		_fileDescriptor = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+		if(_fileDescriptor == -1)
+		{
+			GD::out.printError("Error: Could not open recording file " + filename + ": " + std::string(strerror(errno)));
+			return false;
+		}
+
+		//Allocate the whole file up front, so writing records never has to extend it.
+		int result = posix_fallocate(_fileDescriptor, 0, _fileSize);
+		if(result != 0)
+		{
+			GD::out.printError("Error: Could not allocate recording file " + filename + ": " + std::string(strerror(result)));
+			closeFile();
+			return false;
+		}
+
+		void* mapping = mmap(nullptr, _fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fileDescriptor, 0);
+		if(mapping == MAP_FAILED)
+		{
+			GD::out.printError("Error: Could not map recording file " + filename + ": " + std::string(strerror(errno)));
+			closeFile();
+			return false;
+		}
+		_mapping = (uint8_t*)mapping;
+
+		memset(_mapping, 0, fileHeaderSize);
+		memcpy(_mapping, magic, sizeof(magic));
+		uint32_t fileVersion = version;
+		uint32_t headerSize = fileHeaderSize;
+		memcpy(_mapping + 8, &fileVersion, sizeof(fileVersion));
+		memcpy(_mapping + 12, &headerSize, sizeof(headerSize));
+		uint64_t dataEnd = fileHeaderSize;
+		memcpy(_mapping + dataEndOffset, &dataEnd, sizeof(dataEnd));
+		memcpy(_mapping + sequenceOffset, &_sequence, sizeof(_sequence));
+		memcpy(_mapping + interfaceIdOffset, _interfaceId.data(), std::min(_interfaceId.size(), (size_t)31));
+		_fileLayout = _layout.load(std::memory_order_relaxed);
+		memcpy(_mapping + layoutOffset, &_fileLayout, sizeof(_fileLayout));
+		_sequence++;
+
+		_position = fileHeaderSize;
+		_keyFrameRequired = true;
+		return true;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return false;
+}
+
+void ProcessImageRecorder::closeFile()
+{
+	try
+	{
+		if(_mapping)
+		{
+			msync(_mapping, _fileSize, MS_ASYNC);
+			munmap(_mapping, _fileSize);
+			_mapping = nullptr;
+		}
+		if(_fileDescriptor != -1)
+		{
+			close(_fileDescriptor);
+			_fileDescriptor = -1;
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void ProcessImageRecorder::encode(const Slot& slot)
+{
+	_record.clear();
+
+	int64_t timeDelta = slot.time - _lastTime;
+	bool keyFrame = _keyFrameRequired || slot.inputs.size() != _lastInputs.size() || slot.outputs.size() != _lastOutputs.size() || timeDelta < 0 || timeDelta > 0xFFFFFFFFll;
+
+	uint32_t registerCount = slot.inputs.size() + slot.outputs.size();
+	uint32_t maskSize = (registerCount + 7) / 8;
+	uint32_t timeSize = keyFrame ? 8 : 4;
+	_record.resize(recordHeaderSize + timeSize + maskSize, 0);
+	uint8_t* mask = _record.data() + recordHeaderSize + timeSize;
+
+	uint32_t changedRegisters = 0;
+	for(uint32_t i = 0; i < registerCount; i++)
+	{
+		uint16_t value = i < slot.inputs.size() ? slot.inputs[i] : slot.outputs[i - slot.inputs.size()];
+		if(!keyFrame)
+		{
+			uint16_t lastValue = i < _lastInputs.size() ? _lastInputs[i] : _lastOutputs[i - _lastInputs.size()];
+			if(value == lastValue) continue;
+		}
+		mask[i / 8] |= 1 << (i % 8);
+		changedRegisters++;
+	}
+
+	if(!keyFrame && changedRegisters == 0)
+	{
+		_record.clear();
+		return;
+	}
+
+	//The mask pointer is invalidated by resizing, so the values are appended in a second pass.
+	_record.reserve(_record.size() + changedRegisters * 2);
+	for(uint32_t i = 0; i < registerCount; i++)
+	{
+		if(!(_record[recordHeaderSize + timeSize + i / 8] & (1 << (i % 8)))) continue;
+		uint16_t value = i < slot.inputs.size() ? slot.inputs[i] : slot.outputs[i - slot.inputs.size()];
+		_record.push_back((uint8_t)(value & 0xFF));
+		_record.push_back((uint8_t)(value >> 8));
+	}
+
+	uint32_t recordSize = _record.size();
+	uint8_t flags = keyFrame ? keyFrameFlag : 0;
+	uint16_t inputCount = slot.inputs.size();
+	uint16_t outputCount = slot.outputs.size();
+	memcpy(_record.data(), &recordSize, sizeof(recordSize));
+	memcpy(_record.data() + 4, &flags, sizeof(flags));
+	memcpy(_record.data() + 6, &inputCount, sizeof(inputCount));
+	memcpy(_record.data() + 8, &outputCount, sizeof(outputCount));
+	if(keyFrame) memcpy(_record.data() + recordHeaderSize, &slot.time, sizeof(slot.time));
+	else
+	{
+		uint32_t delta = timeDelta;
+		memcpy(_record.data() + recordHeaderSize, &delta, sizeof(delta));
+	}
+
+	_keyFrameRequired = false;
+	_lastTime = slot.time;
+	_lastInputs.assign(slot.inputs.begin(), slot.inputs.end());
+	_lastOutputs.assign(slot.outputs.begin(), slot.outputs.end());
+}
+
+}
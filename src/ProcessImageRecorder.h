@@ -0,0 +1,113 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#ifndef PROCESSIMAGERECORDER_H_
+#define PROCESSIMAGERECORDER_H_
+
+#include <homegear-base/BaseLib.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace MyFamily
+{
+
+/**
+ * Records changed process images of an interface to rotating memory-mapped files. The listen thread only copies the
+ * image into a preallocated queue. Encoding and writing happens in a separate thread.
+ *
+ * File format (little endian):
+ *
+ * File header (96 bytes): magic "HGBKREC1", uint32 version, uint32 header size, uint64 end of the valid records, uint64
+ * sequence number of the file, 32 bytes null terminated interface ID, uint16 analog input bits, analog output bits,
+ * digital input bits and digital output bits of the bus coupler, 24 reserved bytes.
+ *
+ * Record: uint32 record size, uint8 flags, uint8 reserved, uint16 number of input registers, uint16 number of output
+ * registers, uint16 reserved, the time (int64 microseconds for key frames, uint32 microseconds since the previous
+ * record otherwise), a change mask with one bit per input and output register and the values of all changed
+ * registers. In key frames all registers are marked as changed. The first record of every file is a key frame.
+ */
+class ProcessImageRecorder
+{
+public:
+	static constexpr char magic[8] = { 'H', 'G', 'B', 'K', 'R', 'E', 'C', '1' };
+	static constexpr uint32_t version = 1;
+	static constexpr uint32_t fileHeaderSize = 96;
+	static constexpr uint32_t dataEndOffset = 16;
+	static constexpr uint32_t sequenceOffset = 24;
+	static constexpr uint32_t interfaceIdOffset = 32;
+	static constexpr uint32_t layoutOffset = 64;
+	static constexpr uint32_t recordHeaderSize = 12;
+	static constexpr uint8_t keyFrameFlag = 1;
+
+	ProcessImageRecorder(const std::string& interfaceId, const std::string& path, uint32_t fileSize, uint32_t fileCount);
+	virtual ~ProcessImageRecorder();
+
+	void start();
+	void stop();
+
+	/**
+	 * Sets the bit counts written to the file header. When they change, recording continues in a new file.
+	 */
+	void setLayout(uint16_t analogInputBits, uint16_t analogOutputBits, uint16_t digitalInputBits, uint16_t digitalOutputBits);
+
+	/**
+	 * Queues an image. Never waits for disk I/O. When the queue is full, the image is dropped and false is returned.
+	 */
+	bool record(int64_t time, const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs);
+	uint64_t getDroppedImages() { return _droppedImages.load(std::memory_order_relaxed); }
+private:
+	struct Slot
+	{
+		int64_t time = 0;
+		std::vector<uint16_t> inputs;
+		std::vector<uint16_t> outputs;
+	};
+
+	std::string _interfaceId;
+	std::string _path;
+	uint32_t _fileSize = 0;
+	uint32_t _fileCount = 0;
+
+	//{{{ Single producer, single consumer queue
+	std::vector<Slot> _slots;
+	std::atomic<uint32_t> _head{0}; //Next slot to encode. Only written by the recorder thread.
+	std::atomic<uint32_t> _tail{0}; //Next slot to fill. Only written by the listen thread.
+	std::atomic<uint64_t> _droppedImages{0};
+	std::atomic<uint64_t> _layout{0}; //The four bit counts of the header packed into one value
+	std::mutex _wakeUpMutex;
+	std::condition_variable _wakeUpConditionVariable;
+	//}}}
+
+	std::thread _recorderThread;
+	std::atomic_bool _stopRecorderThread{true};
+
+	//{{{ Only accessed by the recorder thread
+	int _fileDescriptor = -1;
+	uint8_t* _mapping = nullptr;
+	uint32_t _position = 0;
+	uint32_t _fileIndex = 0;
+	uint64_t _sequence = 0;
+	uint64_t _fileLayout = 0;
+	bool _keyFrameRequired = true;
+	bool _sizeErrorPrinted = false;
+	int64_t _lastTime = 0;
+	std::vector<uint16_t> _lastInputs;
+	std::vector<uint16_t> _lastOutputs;
+	std::vector<uint8_t> _record;
+	//}}}
+
+	void recorderThread();
+	bool openNextFile();
+	void closeFile();
+
+	/**
+	 * Encodes the slot into _record. _record is left empty when nothing changed.
+	 */
+	void encode(const Slot& slot);
+};
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#include "SharedMemoryExport.h"
+#include "GD.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace MyFamily
+{
+
+constexpr char SharedMemoryExport::magic[8];
+
+SharedMemoryExport::SharedMemoryExport(const std::string& interfaceId, bool writesEnabled) : _writesEnabled(writesEnabled)
+{
+	static_assert(sizeof(Header) == headerSize, "Unexpected header size.");
+	static_assert(sizeof(WriteSlot) == 16, "Unexpected write slot size.");
+
+	_name = "/homegear-beckhoff-" + interfaceId;
+	for(uint32_t i = 1; i < _name.size(); i++)
+	{
+		if(_name[i] == '/') _name[i] = '_';
+	}
+	_size = headerSize + 2 * maxRegisters * sizeof(uint16_t) + writeSlotCount * sizeof(WriteSlot);
+}
+
+SharedMemoryExport::~SharedMemoryExport()
+{
+	close();
+}
+
+bool SharedMemoryExport::open()
+{
+	try
+	{
+		close();
+
+		//Remove segments left by a crashed instance, so clients never see a stale image.
+		shm_unlink(_name.c_str());
+		_fileDescriptor = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, _writesEnabled ? 0660 : 0640);
+		if(_fileDescriptor == -1)
+		{
+			GD::out.printError("Error: Could not create shared memory segment " + _name + ": " + std::string(strerror(errno)));
+			return false;
+		}
+
+		if(ftruncate(_fileDescriptor, _size) == -1)
+		{
+			GD::out.printError("Error: Could not resize shared memory segment " + _name + ": " + std::string(strerror(errno)));
+			close();
+			return false;
+		}
+
+		void* mapping = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fileDescriptor, 0);
+		if(mapping == MAP_FAILED)
+		{
+			GD::out.printError("Error: Could not map shared memory segment " + _name + ": " + std::string(strerror(errno)));
+			close();
+			return false;
+		}
+		_mapping = (uint8_t*)mapping;
+
+		//The segment is zero filled by ftruncate(), which is a valid initial state of the atomics.
+		_header = (Header*)_mapping;
+		_inputs = (uint16_t*)(_mapping + headerSize);
+		_outputs = _inputs + maxRegisters;
+		_writeSlots = (WriteSlot*)(_outputs + maxRegisters);
+
+		memcpy(_header->magic, magic, sizeof(magic));
+		_header->version = version;
+		_header->headerSize = headerSize;
+		_header->inputsOffset = headerSize;
+		_header->outputsOffset = headerSize + maxRegisters * sizeof(uint16_t);
+		_header->writeSlotsOffset = headerSize + 2 * maxRegisters * sizeof(uint16_t);
+		_header->writeSlotCount = _writesEnabled ? writeSlotCount : 0;
+		_header->maxRegisters = maxRegisters;
+		return true;
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+	return false;
+}
+
+void SharedMemoryExport::close()
+{
+	try
+	{
+		if(_mapping)
+		{
+			munmap(_mapping, _size);
+			_mapping = nullptr;
+			_header = nullptr;
+			_inputs = nullptr;
+			_outputs = nullptr;
+			_writeSlots = nullptr;
+		}
+		if(_fileDescriptor != -1)
+		{
+			::close(_fileDescriptor);
+			_fileDescriptor = -1;
+			shm_unlink(_name.c_str());
+		}
+	}
+	catch(const std::exception& ex)
+	{
+		GD::out.printEx(__FILE__, __LINE__, __PRETTY_FUNCTION__, ex.what());
+	}
+}
+
+void SharedMemoryExport::publish(int64_t time, const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs)
+{
+	if(!_header) return;
+	uint32_t inputCount = std::min((uint32_t)inputs.size(), maxRegisters);
+	uint32_t outputCount = std::min((uint32_t)outputs.size(), maxRegisters);
+
+	uint64_t sequence = _header->sequence.load(std::memory_order_relaxed);
+	_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	_header->time = time;
+	_header->inputCount = inputCount;
+	_header->outputCount = outputCount;
+	if(inputCount > 0) memcpy(_inputs, inputs.data(), inputCount * sizeof(uint16_t));
+	if(outputCount > 0) memcpy(_outputs, outputs.data(), outputCount * sizeof(uint16_t));
+
+	_header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SharedMemoryExport::takeWriteRequests(std::vector<WriteRequest>& requests)
+{
+	requests.clear();
+	if(!_writeSlots || !_writesEnabled) return;
+	for(uint32_t i = 0; i < writeSlotCount; i++)
+	{
+		WriteSlot& slot = _writeSlots[i];
+		if(slot.state.load(std::memory_order_acquire) != writeSlotReady) continue;
+		WriteRequest request;
+		request.startBit = slot.startBit;
+		request.bitCount = slot.bitCount;
+		request.value = slot.value;
+		slot.state.store(writeSlotFree, std::memory_order_release);
+		requests.push_back(request);
+	}
+}
+
+}
@@ -0,0 +1,106 @@
+/* Copyright 2013-2019 Homegear GmbH */
+
+#ifndef SHAREDMEMORYEXPORT_H_
+#define SHAREDMEMORYEXPORT_H_
+
+#include <homegear-base/BaseLib.h>
+
+#include <atomic>
+
+namespace MyFamily
+{
+
+/**
+ * Publishes the process image of an interface in the POSIX shared memory segment "/homegear-beckhoff-<interface ID>",
+ * so local processes can read it without RPC calls.
+ *
+ * Segment layout (little endian):
+ *
+ * Header (64 bytes): magic "HGBKSHM1", uint32 version, uint32 header size, uint64 sequence, int64 time of the image in
+ * microseconds, uint32 number of input registers, uint32 number of output registers, uint32 offset of the inputs,
+ * uint32 offset of the outputs, uint32 offset of the write slots, uint32 number of write slots, uint32 maximum number of
+ * registers per image, 4 reserved bytes.
+ *
+ * The sequence is a seqlock: it is odd while the image is updated. Readers load it, copy the data they need, load it
+ * again and retry when it was odd or changed.
+ *
+ * Write slot (16 bytes): uint32 state, uint32 start bit, uint32 bit count (1 to 16), uint16 value, 2 reserved bytes. A
+ * client claims a free slot by changing the state from 0 to 1 with compare and exchange, fills in the request and sets
+ * the state to 2. The slot is applied during the next cycle and set back to 0. Writes bypass the peers, so the
+ * variables of the output peers are not updated.
+ */
+class SharedMemoryExport
+{
+public:
+	static constexpr char magic[8] = { 'H', 'G', 'B', 'K', 'S', 'H', 'M', '1' };
+	static constexpr uint32_t version = 1;
+	static constexpr uint32_t headerSize = 64;
+	static constexpr uint32_t maxRegisters = 2048; //Process image size of the coupler's Modbus address space
+	static constexpr uint32_t writeSlotCount = 16;
+	static constexpr uint32_t writeSlotFree = 0;
+	static constexpr uint32_t writeSlotClaimed = 1;
+	static constexpr uint32_t writeSlotReady = 2;
+
+	struct WriteRequest
+	{
+		uint32_t startBit = 0;
+		uint32_t bitCount = 0;
+		uint16_t value = 0;
+	};
+
+	SharedMemoryExport(const std::string& interfaceId, bool writesEnabled);
+	virtual ~SharedMemoryExport();
+
+	bool open();
+	void close();
+
+	/**
+	 * Copies the image into the segment. Only called by the listen thread.
+	 */
+	void publish(int64_t time, const std::vector<uint16_t>& inputs, const std::vector<uint16_t>& outputs);
+
+	/**
+	 * Takes the pending write requests of clients. Only called by the listen thread.
+	 */
+	void takeWriteRequests(std::vector<WriteRequest>& requests);
+private:
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		std::atomic<uint64_t> sequence;
+		int64_t time;
+		uint32_t inputCount;
+		uint32_t outputCount;
+		uint32_t inputsOffset;
+		uint32_t outputsOffset;
+		uint32_t writeSlotsOffset;
+		uint32_t writeSlotCount;
+		uint32_t maxRegisters;
+		uint32_t reserved;
+	};
+
+	struct WriteSlot
+	{
+		std::atomic<uint32_t> state;
+		uint32_t startBit;
+		uint32_t bitCount;
+		uint16_t value;
+		uint16_t reserved;
+	};
+
+	std::string _name;
+	bool _writesEnabled = false;
+	int _fileDescriptor = -1;
+	uint8_t* _mapping = nullptr;
+	uint32_t _size = 0;
+	Header* _header = nullptr;
+	uint16_t* _inputs = nullptr;
+	uint16_t* _outputs = nullptr;
+	WriteSlot* _writeSlots = nullptr;
+};
+
+}
+
+#endif